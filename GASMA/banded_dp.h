@@ -0,0 +1,233 @@
+#ifndef GASMA_BANDED_DP_H
+#define GASMA_BANDED_DP_H
+
+#include "utils.h"
+#include <algorithm>
+#include <climits>
+#include <string>
+#include <vector>
+
+/**
+ * Exact global alignment with affine gap penalty (Gotoh), restricted to the cells that can
+ * still lead to an alignment within a cost budget. Usually the budget is the cost of the
+ * greedy algorithm, which is an upper bound of the optimal cost. Then
+ * 1. the band only covers the lanes that a path within the budget can reach, as leaving the
+ *    lanes between 0 and the destination lane costs two gaps per extra lane, and
+ * 2. a cell is pruned if its cost plus the gaps still needed to reach the destination lane
+ *    exceeds the budget, counting every gap character at min(o, e).
+ * A gap of length L costs o + e * (L - 1), as in switch_lane_penalty().
+ */
+class banded_dp {
+protected:
+    // the read (A) and the reference (B), and their lengths
+    std::string A, B;
+    int m, n;
+
+    // mismatch, gap opening and gap extension penalty
+    int x, o, e;
+
+    // lanes covered by the band, where lane = column of B - row of A
+    int lowest_lane, highest_lane;
+
+    // best cost of a path ending at each cell with a match/mismatch (H), a deletion (E)
+    // or an insertion (F), stored row by row for the lanes in the band
+    std::vector<int> H, E, F;
+
+    // result of the alignment
+    int cost;
+    std::string CIGAR;
+    termination_t termination;
+
+    // number of cells computed in the last run
+    long num_cells;
+
+    static constexpr int INF = INT_MAX / 2;
+
+    /**
+     * Index of cell (i, j) in H, E and F, or -1 if it is outside of the band.
+     */
+    int _index(int i, int j) const {
+        int lane = j - i;
+        if (i < 0 || j < 0 || j > n || lane < lowest_lane || lane > highest_lane) {
+            return -1;
+        }
+        return i * (highest_lane - lowest_lane + 1) + lane - lowest_lane;
+    }
+
+    int _get(const std::vector<int>& matrix, int i, int j) const {
+        int index = _index(i, j);
+        return index < 0 ? INF : matrix[index];
+    }
+
+    /**
+     * Walk back from (m, n) to (0, 0) and produce the CIGAR string.
+     */
+    void _traceback() {
+        std::string operations;
+        int i = m, j = n;
+        // 0: H, 1: E (deletion), 2: F (insertion)
+        int state = 0;
+        while (i > 0 || j > 0) {
+            if (state == 0) {
+                int h = _get(H, i, j);
+                if (i > 0 && j > 0 && h == _get(H, i - 1, j - 1) + (A[i - 1] == B[j - 1] ? 0 : x)) {
+                    operations += 'M';
+                    i--;
+                    j--;
+                } else if (h == _get(E, i, j)) {
+                    state = 1;
+                } else {
+                    state = 2;
+                }
+            } else if (state == 1) {
+                int value = _get(E, i, j);
+                operations += 'D';
+                state = value == _get(H, i, j - 1) + o ? 0 : 1;
+                j--;
+            } else {
+                int value = _get(F, i, j);
+                operations += 'I';
+                state = value == _get(H, i - 1, j) + o ? 0 : 2;
+                i--;
+            }
+        }
+
+        CIGAR = compress_CIGAR(operations, true);
+    }
+
+public:
+    /**
+     * Constructor of the class that sets the penalty scheme.
+     * @param _x penalty for mismatch. Default: 1.
+     * @param _o gap opening penalty. Default: 1.
+     * @param _e gap extension penalty. Default: 1.
+     */
+    explicit banded_dp(int _x = 1, int _o = 1, int _e = 1) {
+        x = _x;
+        o = _o;
+        e = _e;
+        m = n = 0;
+        lowest_lane = highest_lane = 0;
+        cost = 0;
+        termination = COMPLETED;
+        num_cells = 0;
+    }
+
+    /**
+     * Reset the object to get ready for the next alignment.
+     * @param read the read string.
+     * @param read_len length of the read string.
+     * @param ref the reference string.
+     * @param ref_len length of the reference string.
+     */
+    void reset(const char* read, const int read_len, const char* ref, const int ref_len) {
+        A.assign(read, read_len);
+        B.assign(ref, ref_len);
+        m = read_len;
+        n = ref_len;
+        cost = 0;
+        termination = COMPLETED;
+        num_cells = 0;
+        CIGAR.clear();
+    }
+
+    void reset(const char* read, const char* ref) {
+        reset(read, static_cast<int>(strlen(read)), ref, static_cast<int>(strlen(ref)));
+    }
+
+    /**
+     * Find the optimal alignment if its cost is at most max_cost. Must be called after reset().
+     * @param max_cost the cost budget, e.g. the cost of the greedy algorithm. Default: no limit,
+     *                 i.e. full Needleman-Wunsch.
+     * @return COMPLETED, or COST_EXCEEDED if every alignment costs more than max_cost.
+     */
+    termination_t run(int max_cost = INF) {
+        int destination_lane = n - m;
+        int gap = std::min(o, e);
+        max_cost = std::min(max_cost, INF - 1);
+        if (gap * abs(destination_lane) > max_cost) {
+            cost = max_cost + 1;
+            termination = COST_EXCEEDED;
+            return termination;
+        }
+
+        // a path within max_cost has at most max_cost / gap gaps, |n - m| of them to reach the
+        // destination lane, and two for each lane it goes beyond
+        int excursion = gap > 0 ? (max_cost / gap - abs(destination_lane)) / 2 : std::max(m, n);
+        lowest_lane = std::max(-m, std::min(0, destination_lane) - excursion);
+        highest_lane = std::min(n, std::max(0, destination_lane) + excursion);
+        int width = highest_lane - lowest_lane + 1;
+        H.assign((m + 1) * width, INF);
+        E.assign((m + 1) * width, INF);
+        F.assign((m + 1) * width, INF);
+
+        for (int i = 0; i <= m; i++) {
+            for (int lane = std::max(lowest_lane, -i); lane <= std::min(highest_lane, n - i); lane++) {
+                int j = i + lane;
+                int index = _index(i, j);
+                int h, deletion, insertion;
+                if (i == 0 && j == 0) {
+                    h = 0;
+                    deletion = insertion = INF;
+                } else {
+                    deletion = std::min(_get(H, i, j - 1) + o, _get(E, i, j - 1) + e);
+                    insertion = std::min(_get(H, i - 1, j) + o, _get(F, i - 1, j) + e);
+                    h = std::min(deletion, insertion);
+                    if (i > 0 && j > 0) {
+                        h = std::min(h, _get(H, i - 1, j - 1) + (A[i - 1] == B[j - 1] ? 0 : x));
+                    }
+                }
+                num_cells++;
+                // prune the cell if it cannot reach the destination within the budget
+                if (h + gap * abs(destination_lane - lane) > max_cost) {
+                    continue;
+                }
+                H[index] = h;
+                E[index] = std::min(deletion, INF);
+                F[index] = std::min(insertion, INF);
+            }
+        }
+
+        cost = _get(H, m, n);
+        if (cost > max_cost) {
+            cost = max_cost + 1;
+            termination = COST_EXCEEDED;
+            return termination;
+        }
+        termination = COMPLETED;
+        _traceback();
+        return termination;
+    }
+
+    /**
+     * Return the cost of the optimal alignment. If the last run() stopped with COST_EXCEEDED,
+     * this is max_cost + 1.
+     */
+    int get_cost() const {
+        return cost;
+    }
+
+    /**
+     * Return the reason why the last run() stopped.
+     */
+    termination_t get_termination() const {
+        return termination;
+    }
+
+    /**
+     * Get the CIGAR string. Must be called after run().
+     */
+    const std::string& get_CIGAR() const {
+        return CIGAR;
+    }
+
+    /**
+     * Return the number of cells computed in the last run().
+     */
+    long get_num_cells() const {
+        return num_cells;
+    }
+};
+
+
+#endif //GASMA_BANDED_DP_H
@@ -0,0 +1,138 @@
+#ifndef GASMA_BATCH_ALIGNER_H
+#define GASMA_BATCH_ALIGNER_H
+
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "thread_pool.h"
+#include "hurdle_matrix.h"
+
+#ifndef BATCH_CHUNK_SIZE
+#define BATCH_CHUNK_SIZE 64  // number of pairs a worker takes from a queue at once
+#endif
+
+/**
+ * A pair of strings to align. The strings do not need to be null-terminated.
+ */
+struct alignment_pair {
+    std::string_view read;
+    std::string_view ref;
+};
+
+/**
+ * Result of the greedy alignment of one pair.
+ */
+struct alignment_result {
+    int cost = 0;
+    termination_t termination = COMPLETED;
+    std::string CIGAR;
+};
+
+/**
+ * Align many pairs in parallel with the greedy algorithm. Each worker of a work-stealing
+ * thread_pool owns one hurdle_matrix, which is reused for all the pairs it aligns, so no
+ * state is shared between the workers.
+ * @tparam T either `int_128bit` (SSE) or `int_256bit` (AVX2).
+ */
+template <typename T>
+class batch_aligner {
+protected:
+    thread_pool pool;
+
+    // one hurdle matrix per worker
+    std::vector<hurdle_matrix<T>*> matrices;
+
+    // band width
+    int k;
+
+    // number of pairs a worker takes at once
+    int chunk_size;
+
+public:
+    /**
+     * Constructor of the batch aligner.
+     * @param num_threads number of workers. Default: 0, i.e. one per hardware thread.
+     * @param _k band width. Default: 3.
+     * @param _alignment_type the type of alignment, either GLOBAL or SEMI_GLOBAL. Default: GLOBAL.
+     * @param _x penalty for mismatch. Default: 1.
+     * @param _o gap opening penalty. Default: 1.
+     * @param _e gap extension penalty. Default: 1.
+     * @param _chunk_size number of pairs a worker takes at once. Default: BATCH_CHUNK_SIZE.
+     */
+    explicit batch_aligner(int num_threads = 0,
+                           int _k = 3,
+                           alignment_type_t _alignment_type = GLOBAL,
+                           int _x = 1,
+                           int _o = 1,
+                           int _e = 1,
+                           int _chunk_size = BATCH_CHUNK_SIZE) : pool(num_threads) {
+        k = _k;
+        chunk_size = _chunk_size;
+        for (int i = 0; i < pool.size(); i++) {
+            matrices.push_back(new hurdle_matrix<T>(_alignment_type, _x, _o, _e));
+        }
+    }
+
+    batch_aligner(const batch_aligner&) = delete;
+    batch_aligner& operator=(const batch_aligner&) = delete;
+
+    /**
+     * Align all pairs and write the result of pairs[i] to results[i].
+     * @param pairs the pairs to align.
+     * @param results preallocated results, at least as many as pairs.
+     */
+    void align_batch(std::span<const alignment_pair> pairs, std::span<alignment_result> results) {
+        int num_pairs = static_cast<int>(std::min(pairs.size(), results.size()));
+        for_each(num_pairs, [&](hurdle_matrix<T>& matrix, int i) {
+            const alignment_pair& pair = pairs[i];
+            matrix.reset(pair.read.data(), static_cast<int>(pair.read.size()),
+                         pair.ref.data(), static_cast<int>(pair.ref.size()), k);
+            matrix.run();
+            results[i].cost = matrix.get_cost();
+            results[i].termination = matrix.get_termination();
+            results[i].CIGAR = matrix.get_CIGAR();
+        });
+    }
+
+    /**
+     * Call f(matrix, i) for i = 0, ..., num_items - 1 in parallel, where `matrix` is the hurdle
+     * matrix of the worker that handles item i. Used to align with other settings or to write
+     * the results in another format than align_batch().
+     * @param num_items number of items.
+     * @param f the function to call for each item. It must not throw.
+     */
+    void for_each(int num_items, const std::function<void(hurdle_matrix<T>&, int)>& f) {
+        pool.parallel_for(num_items, chunk_size, [&](int worker, int begin, int end) {
+            hurdle_matrix<T>& matrix = *matrices[worker];
+            for (int i = begin; i < end; i++) {
+                f(matrix, i);
+            }
+        });
+    }
+
+    /**
+     * Return the number of workers.
+     */
+    int get_num_threads() const {
+        return pool.size();
+    }
+
+    /**
+     * Return the band width.
+     */
+    int get_band() const {
+        return k;
+    }
+
+    ~batch_aligner() {
+        for (auto matrix : matrices) {
+            delete matrix;
+        }
+    }
+};
+
+
+#endif //GASMA_BATCH_ALIGNER_H
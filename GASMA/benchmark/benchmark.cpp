@@ -8,26 +8,76 @@
 #include <vector>
 
 #define USE_SIMULATED_DATA false
+#define DATASET_SEED DATASET_DEFAULT_SEED
+#define USE_PERF_COUNTERS false
+
+// run each engine in its own passes (with warm-up and NUM_TRIALS trials) instead of all
+// engines on each pair
+#define SEPARATE_PASSES false
+#define NUM_TRIALS 5
+
+// measure the scaling of the engines up to MAX_THREADS threads (0: one per hardware thread)
+#define SCALING false
+#define MAX_THREADS 0
+
+// write every metric to REPORT_PATH.json and REPORT_PATH.csv, to be compared with gasma-compare
+#define REPORT_PATH "benchmark_results"
+#define GREEDY_MODE FIXED_BAND
+
+// band width, or the largest band width if the band is adaptive
+#define BAND_WIDTH (GREEDY_MODE == ADAPTIVE_BAND ? 24 : 3)
 
 int main () {
+    benchmark_report report;
     if (USE_SIMULATED_DATA) {
         int num_reads = 5000000;
         int length = 100;
         std::vector<float> error_rates = {0.05, 0.10, 0.15, 0.20};
 
         for (auto error_rate: error_rates) {
-            Dataset dataset(num_reads, length, error_rate, 0.96, true);
+            Dataset dataset(num_reads, length, error_rate, 0.96, true, false, DATASET_SEED);
             std::string output_dir = dataset.output();
 
-            benchmark bench(1, 1, 1, 3, 1000000, true);
+            benchmark bench(1, 1, 1, BAND_WIDTH, 1000000, true, GREEDY_MODE);
+            if (USE_PERF_COUNTERS) {
+                bench.enable_perf_counters();
+            }
             bench.read_string_file(output_dir.c_str());
-            bench.run();
+            if (SEPARATE_PASSES) {
+                bench.run_separate(NUM_TRIALS);
+            } else {
+                bench.run();
+            }
             bench.print();
+            bench.print_histograms();
+            bench.print_perf_counters();
+            if (SCALING) {
+                bench.run_scaling(MAX_THREADS);
+            }
+            char name[32];
+            snprintf(name, sizeof(name), "error_rate=%.2f", error_rate);
+            bench.report(report, name);
         }
     } else {
-        benchmark bench(1, 1, 1, 3, 100000, true);
+        benchmark bench(1, 1, 1, BAND_WIDTH, 100000, true, GREEDY_MODE);
+        if (USE_PERF_COUNTERS) {
+            bench.enable_perf_counters();
+        }
         bench.read_string_file("/home/zhenhao/dna-align-dataset/SRR611076.data");
-        bench.run();
+        if (SEPARATE_PASSES) {
+            bench.run_separate(NUM_TRIALS);
+        } else {
+            bench.run();
+        }
         bench.print();
+        bench.print_histograms();
+        bench.print_perf_counters();
+        if (SCALING) {
+            bench.run_scaling(MAX_THREADS);
+        }
+        bench.report(report, "SRR611076");
+    }
+    if (!report.write_json(REPORT_PATH ".json") || !report.write_csv(REPORT_PATH ".csv")) {
+        printf("Unable to write the results to %s.json and %s.csv\n", REPORT_PATH, REPORT_PATH);
     }
 }
\ No newline at end of file
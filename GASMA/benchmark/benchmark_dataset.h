@@ -36,14 +36,17 @@
  * DESCRIPTION: Sequence Generator for benchmarking pairwise algorithms
  */
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
-#include <getopt.h>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <cmath>
-#include <ctime>
+#include <string>
+#include <vector>
+
+#include "../thread_pool.h"
 
 #ifndef ALPHABET_SIZE
 #define ALPHABET_SIZE 4
@@ -52,11 +55,68 @@ char alphabet[] = {
         'A','C','G','T'
 };
 
+#define DATASET_DEFAULT_SEED 2022
+#define DATASET_CHUNK_SIZE 4096     // pairs generated by a worker at once
+
+
+/**
+ * Counter-based random number generator: the n-th number of the stream (key, id) is a hash
+ * of (key, id, n), so any stream can be started anywhere without generating what is before.
+ * The hash is the SplitMix64 finalizer.
+ */
+class counter_rng {
+protected:
+    uint64_t key;
+    uint64_t counter;
+
+    static uint64_t _mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+public:
+    counter_rng(uint64_t seed, uint64_t id) {
+        key = _mix(seed ^ _mix(id + 0x9e3779b97f4a7c15ULL));
+        counter = 0;
+    }
+
+    uint64_t next() {
+        return _mix(key + 0x9e3779b97f4a7c15ULL * ++counter);
+    }
+
+    /**
+     * Return a uniformly random integer in [min, max).
+     */
+    uint64_t uniform(uint64_t min, uint64_t max) {
+        const uint64_t range = max - min;
+        // Lemire's multiply-shift, rejecting the few values that would bias the result
+        __uint128_t product = (__uint128_t) next() * range;
+        if ((uint64_t) product < range) {
+            const uint64_t threshold = -range % range;
+            while ((uint64_t) product < threshold) {
+                product = (__uint128_t) next() * range;
+            }
+        }
+        return min + (uint64_t) (product >> 64);
+    }
+
+    /**
+     * Return a uniformly random number in [0, 1).
+     */
+    double uniform() {
+        return (double) (next() >> 11) * 0x1.0p-53;
+    }
+};
+
 
 /**
  * Utility class to generate simulated dataset of read and ref strings
  * with certain amount of errors. This class is adopted from
  * https://github.com/smarco/WFA/blob/master/tools/generate_dataset.c
+ *
+ * Pair i is generated from its own random stream (seed, i), so the pairs are generated in
+ * parallel, in chunks, and the same seed gives the same file at any number of threads.
  */
 class Dataset {
 private:
@@ -78,116 +138,105 @@ private:
     // probability of mismatches
     float mismatch_rate;
 
-    /**
-     * Generate random number between min and max
-     * @return a uint64 object that is randomly generated between min and max
-     */
-    uint64_t rand_iid(const uint64_t min,const uint64_t max) {
-        int n_rand = rand(); // [0, RAND_MAX]
-        const uint64_t range = max - min;
-        const uint64_t rem = RAND_MAX % range;
-        const uint64_t sample = RAND_MAX / range;
-        // Consider the small interval within remainder of RAND_MAX
-        if (n_rand < RAND_MAX - rem) {
-            return min + n_rand/sample;
-        } else {
-            return rand_iid(min,max);
-        }
-    }
+    // seed of the random streams
+    uint64_t seed;
+
+    // number of threads generating the pairs
+    int num_threads;
+
 /*
  * Generate pattern
  */
     void generate_pattern(
+            counter_rng& rng,
             char* const pattern,
             const uint64_t length) {
         // Generate random characters
         uint64_t i;
         for (i=0;i<length;++i) {
-            pattern[i] = alphabet[rand_iid(0,ALPHABET_SIZE)];
+            pattern[i] = alphabet[rng.uniform(0,ALPHABET_SIZE)];
         }
-        pattern[length] = '\0';
     }
 /*
- * Generate candidate-text from pattern adding random errors
+ * Generate candidate-text from pattern adding random errors. The errors are at distinct
+ * positions of the pattern, chosen in one pass (selection sampling), and the text is written
+ * in the same pass instead of shifting it for every insertion and deletion. A mismatch always
+ * changes the character.
+ * Return the length of the candidate-text.
  */
-    void generate_candidate_text_add_mismatch(
-            char* const candidate_text,
-            const uint64_t candidate_length) {
-        // Generate random mismatch
-        int position = rand_iid(0,candidate_length);
-        char character = alphabet[rand_iid(0,ALPHABET_SIZE)];
-        candidate_text[position] = character;
-    }
-    void generate_candidate_text_add_deletion(
-            char* const candidate_text,
-            uint64_t* const candidate_length) {
-        // Generate random deletion
-        int position = rand_iid(0,*candidate_length);
-        int i;
-        const uint64_t new_candidate_length = *candidate_length - 1;
-        for (i=position;i<new_candidate_length;++i) {
-            candidate_text[i] = candidate_text[i+1];
-        }
-        *candidate_length = new_candidate_length;
-    }
-    void generate_candidate_text_add_insertion(
-            char* const candidate_text,
-            uint64_t* const candidate_length) {
-        // Generate random insertion
-        int position = rand_iid(0,*candidate_length);
-        int i;
-        const uint64_t new_candidate_length = *candidate_length + 1;
-        for (i=new_candidate_length-1;i>position;--i) {
-            candidate_text[i] = candidate_text[i-1];
-        }
-        *candidate_length = new_candidate_length;
-        // Insert random character
-        candidate_text[position] = alphabet[rand_iid(0,ALPHABET_SIZE)];
-    }
-    char* generate_candidate_text(
-            char* const pattern,
+    uint64_t generate_candidate_text(
+            counter_rng& rng,
+            const char* const pattern,
             const uint64_t pattern_length,
-            const float error_degree) {
+            const float error_degree,
+            char* const candidate_text) {
         // Compute nominal number of errors
         uint64_t num_errors;
         if (exact_error_rate)
             num_errors = ceil(pattern_length * error_degree);
         else
-            num_errors = rand_iid(0, ceil(pattern_length * error_degree));
-        // Allocate & init-by-copy candidate text
-        char* const candidate_text = new char[pattern_length + num_errors];
-        uint64_t candidate_length = pattern_length;
-        memcpy(candidate_text,pattern,pattern_length);
-        // Generate random errors
-        int i;
-        for (i=0;i<num_errors;++i) {
-            float random = ((float) std::rand()) / RAND_MAX;
+            num_errors = rng.uniform(0, (uint64_t) ceil(pattern_length * error_degree) + 1);
+        num_errors = std::min(num_errors, pattern_length);
+        uint64_t candidate_length = 0;
+        uint64_t i;
+        for (i=0;i<pattern_length;++i) {
+            // position i has an error with probability (errors left) / (positions left)
+            if (rng.uniform(0, pattern_length - i) >= num_errors) {
+                candidate_text[candidate_length++] = pattern[i];
+                continue;
+            }
+            num_errors--;
             int error_type;
-            if (random <= mismatch_rate) {
+            if (rng.uniform() < mismatch_rate) {
                 error_type = 0;
             } else {
-                error_type = rand_iid(1,3);
+                error_type = rng.uniform(1,3);
             }
             switch (error_type) {
                 case 0:
-                    generate_candidate_text_add_mismatch(candidate_text,candidate_length);
+                    // Generate random mismatch
+                    candidate_text[candidate_length++] = alphabet[(strchr(alphabet, pattern[i]) - alphabet +
+                                                                   rng.uniform(1,ALPHABET_SIZE)) % ALPHABET_SIZE];
                     break;
                 case 1:
-                    generate_candidate_text_add_deletion(candidate_text,&candidate_length);
+                    // Generate random deletion
                     break;
                 default:
-                    generate_candidate_text_add_insertion(candidate_text,&candidate_length);
+                    // Generate random insertion
+                    candidate_text[candidate_length++] = alphabet[rng.uniform(0,ALPHABET_SIZE)];
+                    candidate_text[candidate_length++] = pattern[i];
                     break;
             }
         }
-        // Return candidate-text
-        candidate_text[candidate_length] = '\0';
-        return candidate_text;
+        return candidate_length;
+    }
+/*
+ * Generate pairs [begin, end) into the end of buffer, as ">pattern\n<candidate-text\n".
+ */
+    void generate_pairs(int begin, int end, std::string& buffer) {
+        std::vector<char> pattern(length);
+        std::vector<char> candidate_text(2 * length);
+        for (int i = begin; i < end; ++i) {
+            counter_rng rng(seed, i);
+            generate_pattern(rng, pattern.data(), length);
+            uint64_t candidate_length = generate_candidate_text(rng, pattern.data(), length, error_rate,
+                                                                candidate_text.data());
+            buffer += '>';
+            buffer.append(pattern.data(), length);
+            buffer += "\n<";
+            buffer.append(candidate_text.data(), candidate_length);
+            buffer += '\n';
+        }
     }
 
 public:
-    Dataset(int _num_reads, int _length, float _error_rate, float _mismatch_rate, bool _exact_error_rate = false, bool _overwrite = false) {
-        std::srand(static_cast<unsigned int>(std::time(nullptr)));
+    /**
+     * @param _seed seed of the dataset; the same seed gives the same dataset.
+     * @param _num_threads number of threads generating the pairs. Default: 0, i.e. one per
+     *                     hardware thread.
+     */
+    Dataset(int _num_reads, int _length, float _error_rate, float _mismatch_rate, bool _exact_error_rate = false,
+            bool _overwrite = false, uint64_t _seed = DATASET_DEFAULT_SEED, int _num_threads = 0) {
         num_reads = _num_reads;
         length = _length;
         error_rate = _error_rate;
@@ -204,6 +253,8 @@ public:
         }
         exact_error_rate = _exact_error_rate;
         overwrite = _overwrite;
+        seed = _seed;
+        num_threads = _num_threads;
     }
 
     void output(const char * output_dir) {
@@ -217,32 +268,36 @@ public:
 
         }
         output_file = fopen(output_dir,"w");
-        // Allocate
-        char* const pattern = new char[length + 1];
-        // Read-align loop
-        srand(time(0));
-        int i;
-        for (i = 0; i < num_reads; ++i) {
-            // Prepare pattern
-            generate_pattern(pattern, length);
-            // Print pattern
-            fprintf(output_file, ">%s\n", pattern);
-            // Generate candidate-text
-            char* const candidate_text = generate_candidate_text(
-                    pattern, length, error_rate);
-            // Print candidate-text
-            fprintf(output_file, "<%s\n", candidate_text);
-            delete[] candidate_text;
+        if (output_file == nullptr) {
+            fprintf(stderr, "Unable to open output file: %s\n", output_dir);
+            return;
+        }
+        // The chunks of a round are generated in parallel, then written in order
+        thread_pool pool(num_threads);
+        const int chunks_per_round = 4 * pool.size();
+        std::vector<std::string> buffers(chunks_per_round);
+        for (int round_begin = 0; round_begin < num_reads; round_begin += chunks_per_round * DATASET_CHUNK_SIZE) {
+            int round_chunks = std::min<long>(chunks_per_round,
+                                              ((long) num_reads - round_begin + DATASET_CHUNK_SIZE - 1) / DATASET_CHUNK_SIZE);
+            pool.parallel_for(round_chunks, 1, [&](int, int begin, int end) {
+                for (int chunk = begin; chunk < end; chunk++) {
+                    int first = round_begin + chunk * DATASET_CHUNK_SIZE;
+                    buffers[chunk].clear();
+                    generate_pairs(first, std::min(first + DATASET_CHUNK_SIZE, num_reads), buffers[chunk]);
+                }
+            });
+            for (int chunk = 0; chunk < round_chunks; chunk++) {
+                fwrite(buffers[chunk].data(), 1, buffers[chunk].size(), output_file);
+            }
         }
-        // Close files & free
+        // Close files
         fclose(output_file);
-        delete[] pattern;
     }
 
     std::string output() {
         std::string output_file_name;
         output_file_name += "simulated_" + std::to_string(num_reads) + "_" + std::to_string(length) + "_" +
-                            std::to_string(error_rate) + "_";
+                            std::to_string(error_rate) + "_" + std::to_string(seed) + "_";
         if (exact_error_rate) {
             output_file_name += "eq.seq";
         } else {
@@ -0,0 +1,456 @@
+#ifndef GASMA_BENCHMARK_REPORT_H
+#define GASMA_BENCHMARK_REPORT_H
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// flags the benchmark was compiled with, defined by CMake
+#ifndef GASMA_BUILD_FLAGS
+#define GASMA_BUILD_FLAGS "unknown"
+#endif
+
+/**
+ * One measurement of a benchmark: the value of a metric of an engine on a dataset.
+ * value: the measurement, e.g. the mean time of the trials, or a percentage.
+ * stddev: standard deviation of the samples behind the value, NAN if unknown.
+ * n: number of samples behind the value (trials, alignments), 0 if not a sample statistic.
+ */
+struct report_row {
+    std::string dataset;
+    std::string engine;
+    std::string metric;
+    double value;
+    double stddev;
+    long n;
+};
+
+/**
+ * Machine-readable results of the benchmark, written as JSON or CSV together with the
+ * machine and the build (CPU model, compiler, flags, instruction sets), so that the results
+ * of two builds or two machines can be compared by compare_reports().
+ *
+ * The metrics are named with their unit: "_s" for seconds, "_us" for microseconds, "_pct"
+ * for percentages of the alignments (proportions of n alignments), "_mb" for megabytes.
+ */
+class benchmark_report {
+protected:
+    std::vector<std::pair<std::string, std::string>> meta;
+    std::vector<report_row> rows;
+
+    static std::string _cpu_model() {
+        std::ifstream cpuinfo("/proc/cpuinfo");
+        std::string line;
+        while (std::getline(cpuinfo, line)) {
+            if (line.rfind("model name", 0) == 0 && line.find(':') != std::string::npos) {
+                return line.substr(line.find(':') + 2);
+            }
+        }
+        return "unknown";
+    }
+
+    static std::string _instruction_sets() {
+        std::string sets;
+#ifdef __SSE4_2__
+        sets += " sse4.2";
+#endif
+#ifdef __BMI__
+        sets += " bmi";
+#endif
+#ifdef __BMI2__
+        sets += " bmi2";
+#endif
+#ifdef __AVX2__
+        sets += " avx2";
+#endif
+#ifdef __AVX512F__
+        sets += " avx512f";
+#endif
+#ifdef __AVX512BW__
+        sets += " avx512bw";
+#endif
+        return sets.empty() ? "none" : sets.substr(1);
+    }
+
+    static std::string _json_string(const std::string& s) {
+        std::string escaped = "\"";
+        for (char c : s) {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+                escaped += c;
+            } else if ((unsigned char) c < 0x20) {
+                char code[8];
+                snprintf(code, sizeof(code), "\\u%04x", c);
+                escaped += code;
+            } else {
+                escaped += c;
+            }
+        }
+        return escaped + "\"";
+    }
+
+    static std::string _json_number(double value) {
+        if (!std::isfinite(value)) {
+            return "null";
+        }
+        char number[32];
+        snprintf(number, sizeof(number), "%.10g", value);
+        return number;
+    }
+
+    static std::string _csv_field(const std::string& s) {
+        if (s.find_first_of(",\"\n") == std::string::npos) {
+            return s;
+        }
+        std::string quoted = "\"";
+        for (char c : s) {
+            quoted += c;
+            if (c == '"') {
+                quoted += '"';
+            }
+        }
+        return quoted + "\"";
+    }
+
+    /**
+     * Split a line of CSV into its fields, with the quotes of _csv_field().
+     */
+    static std::vector<std::string> _csv_split(const std::string& line) {
+        std::vector<std::string> fields(1);
+        bool quoted = false;
+        for (size_t i = 0; i < line.length(); i++) {
+            char c = line[i];
+            if (quoted && c == '"' && i + 1 < line.length() && line[i + 1] == '"') {
+                fields.back() += '"';
+                i++;
+            } else if (c == '"') {
+                quoted = !quoted;
+            } else if (c == ',' && !quoted) {
+                fields.emplace_back();
+            } else if (c != '\r') {
+                fields.back() += c;
+            }
+        }
+        return fields;
+    }
+
+public:
+    /**
+     * Start an empty report, with the description of the machine and the build.
+     */
+    benchmark_report() {
+        char host[256] = "unknown";
+        gethostname(host, sizeof(host) - 1);
+        char date[32];
+        time_t now = time(nullptr);
+        strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+        set("date", date);
+        set("host", host);
+        set("cpu", _cpu_model());
+        set("cpus", std::to_string(std::thread::hardware_concurrency()));
+#if defined(__clang__)
+        set("compiler", std::string("clang ") + __VERSION__);
+#elif defined(__GNUC__)
+        set("compiler", std::string("gcc ") + __VERSION__);
+#endif
+        set("build_flags", GASMA_BUILD_FLAGS);
+        set("instruction_sets", _instruction_sets());
+#ifdef LOOKAHEAD
+        set("greedy_variant", "lookahead");
+#else
+        set("greedy_variant", "default");
+#endif
+    }
+
+    /**
+     * Set a property of the run, e.g. the scoring scheme, replacing its previous value.
+     */
+    void set(const std::string& key, const std::string& value) {
+        for (auto& property : meta) {
+            if (property.first == key) {
+                property.second = value;
+                return;
+            }
+        }
+        meta.emplace_back(key, value);
+    }
+
+    /**
+     * Return a property of the run, or an empty string.
+     */
+    std::string get(const std::string& key) const {
+        for (const auto& property : meta) {
+            if (property.first == key) {
+                return property.second;
+            }
+        }
+        return "";
+    }
+
+    const std::vector<std::pair<std::string, std::string>>& get_meta() const {
+        return meta;
+    }
+
+    const std::vector<report_row>& get_rows() const {
+        return rows;
+    }
+
+    void add(const std::string& dataset, const std::string& engine, const std::string& metric,
+             double value, double stddev = NAN, long n = 0) {
+        rows.push_back({dataset, engine, metric, value, stddev, n});
+    }
+
+    /**
+     * Write the report as a JSON object {"meta": {...}, "results": [{...}, ...]}.
+     * @return false if the file cannot be written.
+     */
+    bool write_json(const char* path) const {
+        FILE* file = fopen(path, "w");
+        if (file == nullptr) {
+            return false;
+        }
+        fprintf(file, "{\n  \"meta\": {");
+        for (size_t i = 0; i < meta.size(); i++) {
+            fprintf(file, "%s\n    %s: %s", i == 0 ? "" : ",", _json_string(meta[i].first).c_str(),
+                    _json_string(meta[i].second).c_str());
+        }
+        fprintf(file, "\n  },\n  \"results\": [");
+        for (size_t i = 0; i < rows.size(); i++) {
+            const report_row& row = rows[i];
+            fprintf(file, "%s\n    {\"dataset\": %s, \"engine\": %s, \"metric\": %s, \"value\": %s, \"stddev\": %s, \"n\": %ld}",
+                    i == 0 ? "" : ",", _json_string(row.dataset).c_str(), _json_string(row.engine).c_str(),
+                    _json_string(row.metric).c_str(), _json_number(row.value).c_str(),
+                    _json_number(row.stddev).c_str(), row.n);
+        }
+        fprintf(file, "\n  ]\n}\n");
+        return fclose(file) == 0;
+    }
+
+    /**
+     * Write the report as CSV with the columns dataset,engine,metric,value,stddev,n, after
+     * the properties of the run as comment lines "# key: value".
+     * @return false if the file cannot be written.
+     */
+    bool write_csv(const char* path) const {
+        FILE* file = fopen(path, "w");
+        if (file == nullptr) {
+            return false;
+        }
+        for (const auto& property : meta) {
+            fprintf(file, "# %s: %s\n", property.first.c_str(), property.second.c_str());
+        }
+        fprintf(file, "dataset,engine,metric,value,stddev,n\n");
+        for (const report_row& row : rows) {
+            fprintf(file, "%s,%s,%s,%.10g,", _csv_field(row.dataset).c_str(), _csv_field(row.engine).c_str(),
+                    _csv_field(row.metric).c_str(), row.value);
+            if (std::isfinite(row.stddev)) {
+                fprintf(file, "%.10g", row.stddev);
+            }
+            fprintf(file, ",%ld\n", row.n);
+        }
+        return fclose(file) == 0;
+    }
+
+    /**
+     * Read a report written by write_csv(), replacing the content of this one.
+     * @return false if the file cannot be read or is not such a report.
+     */
+    bool read_csv(const char* path) {
+        std::ifstream file(path);
+        if (!file) {
+            return false;
+        }
+        meta.clear();
+        rows.clear();
+        std::string line;
+        bool header = false;
+        while (std::getline(file, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (line.empty()) {
+                continue;
+            }
+            if (line[0] == '#') {
+                size_t colon = line.find(": ");
+                if (colon != std::string::npos) {
+                    meta.emplace_back(line.substr(2, colon - 2), line.substr(colon + 2));
+                }
+                continue;
+            }
+            if (!header) {
+                header = line == "dataset,engine,metric,value,stddev,n";
+                if (!header) {
+                    return false;
+                }
+                continue;
+            }
+            std::vector<std::string> fields = _csv_split(line);
+            if (fields.size() != 6) {
+                return false;
+            }
+            add(fields[0], fields[1], fields[2], atof(fields[3].c_str()),
+                fields[4].empty() ? NAN : atof(fields[4].c_str()), atol(fields[5].c_str()));
+        }
+        return header;
+    }
+};
+
+
+/**
+ * Which direction of a metric is better: 1 if higher, -1 if lower, 0 if neither (e.g. the
+ * distribution of the band widths).
+ */
+inline int metric_direction(const std::string& metric) {
+    static const char* const higher[] = {"throughput", "ipc", "accuracy_pct", "coverage_pct", "certified_pct",
+                                         "improved_pct"};
+    static const char* const lower[] = {"time_s", "cycles", "instructions", "branch_misses", "l1d_misses",
+                                        "llc_misses", "peak_rss_mb", "fallback_pct", "ns_per_call"};
+    for (const char* name : higher) {
+        if (metric == name) {
+            return 1;
+        }
+    }
+    for (const char* name : lower) {
+        if (metric == name) {
+            return -1;
+        }
+    }
+    return metric.rfind("latency_", 0) == 0 ? -1 : 0;
+}
+
+/**
+ * Regularized incomplete beta function I_x(a, b), by its continued fraction (modified Lentz).
+ */
+inline double incomplete_beta(double x, double a, double b) {
+    if (x <= 0) {
+        return 0;
+    }
+    if (x >= 1) {
+        return 1;
+    }
+    if (x > (a + 1) / (a + b + 2)) {
+        return 1 - incomplete_beta(1 - x, b, a);
+    }
+    double front = std::exp(std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) + a * std::log(x) + b * std::log1p(-x)) / a;
+    const double tiny = 1e-300;
+    double f = 1, c = 1, d = 0;
+    for (int i = 0; i <= 400; i++) {
+        int m = i / 2;
+        double numerator;
+        if (i == 0) {
+            numerator = 1;
+        } else if (i % 2 == 0) {
+            numerator = m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m));
+        } else {
+            numerator = -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1));
+        }
+        d = 1 + numerator * d;
+        d = 1 / (std::fabs(d) < tiny ? tiny : d);
+        c = 1 + numerator / c;
+        c = std::fabs(c) < tiny ? tiny : c;
+        f *= c * d;
+        if (std::fabs(1 - c * d) < 1e-12) {
+            break;
+        }
+    }
+    return front * (f - 1);
+}
+
+/**
+ * Two-sided p-value of Welch's t-test of the difference of two means, each given by its
+ * mean, standard deviation and number of samples, or NAN if it cannot be tested.
+ */
+inline double welch_p_value(double mean1, double stddev1, long n1, double mean2, double stddev2, long n2) {
+    if (n1 < 2 || n2 < 2 || !std::isfinite(stddev1) || !std::isfinite(stddev2)) {
+        return NAN;
+    }
+    double v1 = stddev1 * stddev1 / n1, v2 = stddev2 * stddev2 / n2;
+    if (v1 + v2 == 0) {
+        return mean1 == mean2 ? 1 : 0;
+    }
+    double t = (mean1 - mean2) / std::sqrt(v1 + v2);
+    double df = (v1 + v2) * (v1 + v2) / (v1 * v1 / (n1 - 1) + v2 * v2 / (n2 - 1));
+    return incomplete_beta(df / (df + t * t), df / 2, 0.5);
+}
+
+/**
+ * Two-sided p-value of the z-test of the difference of two proportions (between 0 and 1) of
+ * n1 and n2 samples, or NAN if it cannot be tested.
+ */
+inline double proportion_p_value(double p1, long n1, double p2, long n2) {
+    if (n1 < 1 || n2 < 1) {
+        return NAN;
+    }
+    double pooled = (p1 * n1 + p2 * n2) / (n1 + n2);
+    double variance = pooled * (1 - pooled) * (1.0 / n1 + 1.0 / n2);
+    if (variance <= 0) {
+        return p1 == p2 ? 1 : 0;
+    }
+    return std::erfc(std::fabs(p1 - p2) / std::sqrt(variance) / std::sqrt(2.0));
+}
+
+/**
+ * The change of a metric between two reports.
+ * change: relative change of the value, (current - base) / base.
+ * p_value: probability of a difference at least as large if the metric did not change, NAN
+ * if there are not enough samples to test it.
+ * significant: whether the change is significant, and larger than the threshold for timings.
+ * regression: whether the change is significant and in the wrong direction.
+ */
+struct report_difference {
+    report_row base;
+    report_row current;
+    double change;
+    double p_value;
+    bool significant;
+    bool regression;
+};
+
+/**
+ * Compare the metrics present in both reports. Percentages of alignments are compared with
+ * a test of proportions, other metrics with samples (the trials of run_separate(), or the
+ * latency of each alignment) with Welch's t-test. As any difference of timings becomes
+ * significant with enough samples, a timing is only flagged if it also changes by more than
+ * `threshold` (relative).
+ * @param alpha significance level of the tests.
+ * @param threshold smallest relative change of a timing that is flagged.
+ */
+inline std::vector<report_difference> compare_reports(const benchmark_report& base, const benchmark_report& current,
+                                                      double alpha = 0.01, double threshold = 0.02) {
+    std::vector<report_difference> differences;
+    for (const report_row& row : current.get_rows()) {
+        auto match = std::find_if(base.get_rows().begin(), base.get_rows().end(), [&](const report_row& other) {
+            return other.dataset == row.dataset && other.engine == row.engine && other.metric == row.metric;
+        });
+        if (match == base.get_rows().end()) {
+            continue;
+        }
+        report_difference difference{*match, row, 0, NAN, false, false};
+        difference.change = match->value == 0 ? (row.value == 0 ? 0 : INFINITY) : (row.value - match->value) / std::fabs(match->value);
+        bool proportion = row.metric.size() > 4 && row.metric.compare(row.metric.size() - 4, 4, "_pct") == 0;
+        if (proportion) {
+            difference.p_value = proportion_p_value(match->value / 100, match->n, row.value / 100, row.n);
+            difference.significant = difference.p_value < alpha;
+        } else {
+            difference.p_value = welch_p_value(match->value, match->stddev, match->n, row.value, row.stddev, row.n);
+            difference.significant = difference.p_value < alpha && std::fabs(difference.change) > threshold;
+        }
+        int direction = metric_direction(row.metric);
+        difference.regression = difference.significant && direction * (row.value - match->value) < 0;
+        differences.push_back(difference);
+    }
+    return differences;
+}
+
+
+#endif //GASMA_BENCHMARK_REPORT_H
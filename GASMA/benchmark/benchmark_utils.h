@@ -5,20 +5,32 @@
 #ifndef GASMA_BENCHMARK_UTILS_H
 #define GASMA_BENCHMARK_UTILS_H
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <barrier>
 #include <iostream>
+#include <pthread.h>
 #include <string>
-#include <sys/times.h>
+#include <thread>
+#include <vector>
 #include <unistd.h>
 #include <cstdio>
 #include <cstdlib>
 #include <fstream>
 
-
 #include "parasail/parasail.h"
 #include "../hurdle_matrix.h"
+#include "../myers_matrix.h"
+#include "../hybrid_aligner.h"
+#include "../banded_dp.h"
+#include "../pair_file.h"
 #include "LEAP_SIMD/LV_BAG.h"
 
 #include "benchmark_coverage.h"
+#include "benchmark_report.h"
+#include "mapped_dataset.h"
+#include "latency_histogram.h"
 
 /**
  * Structure to store the results of alignment.
@@ -38,11 +50,54 @@ public:
 
 
 
+/**
+ * Variants of the greedy algorithm to benchmark.
+ * FIXED_BAND: hurdle_matrix::run() with band width k.
+ * ADAPTIVE_BAND: hurdle_matrix::run_adaptive() with band width up to k.
+ * BIDIRECTIONAL: hurdle_matrix::run_bidirectional() with band width k.
+ * BEAM_SEARCH: hurdle_matrix::run_beam() with band width k and BEAM_WIDTH partial paths.
+ * HYBRID: hybrid_aligner::align() with band width k, falling back to the exact engine if unsure.
+ * POLISHED: hurdle_matrix::run() with band width k, then hurdle_matrix::polish() around the leaps.
+ */
+enum greedy_mode_t {
+    FIXED_BAND,
+    ADAPTIVE_BAND,
+    BIDIRECTIONAL,
+    BEAM_SEARCH,
+    HYBRID,
+    POLISHED
+};
+
+const char* const greedy_mode_names[] = {"fixed_band", "adaptive_band", "bidirectional", "beam_search", "hybrid",
+                                         "polished"};
+
+/**
+ * Engines of the benchmark, in the order of their passes in run_separate(). The DP is run
+ * after the greedy algorithm, as its cost is the budget of the DP.
+ */
+enum engine_t {
+    ENGINE_NW,
+    ENGINE_LEAP,
+    ENGINE_GREEDY,
+    ENGINE_MYERS,
+    ENGINE_DP,
+    NUM_ENGINES
+};
+
+const char* const engine_names[NUM_ENGINES] = {"Needleman-Wunsch", "LEAP", "Greedy", "Myers", "DP (after greedy)"};
+
+#ifndef BEAM_WIDTH
+#define BEAM_WIDTH 4  // number of partial paths kept in BEAM_SEARCH mode
+#endif
+
+
 /**
  * Class for benchmarking. Algorithms for benchmarking include
  * 1. Greedy
  * 2. Needleman-Wunsch (https://github.com/jeffdaily/parasail)
  * 3. LEAP (https://github.com/CMU-SAFARI/LEAP)
+ * 4. Myers' bit-parallel edit distance (exact when x = o = e = 1)
+ * 5. Banded DP bounded by the greedy cost (exact)
  */
 class benchmark {
 private:
@@ -55,6 +110,15 @@ private:
     // Greedy algorithm objects
     hurdle_matrix<int_128bit>* matrix;
 
+    // Bit-parallel edit distance objects
+    myers_matrix<int_128bit>* myers;
+
+    // Greedy algorithm with exact fallback, used in HYBRID mode
+    hybrid_aligner<int_128bit>* hybrid;
+
+    // Affine banded DP, bounded by the cost of the greedy algorithm
+    banded_dp* dp;
+
     // whether we use SIMD acceleration for NW and LEAP
     bool use_SIMD;
 
@@ -67,32 +131,62 @@ private:
     // gap extension penalty (non-negative)
     int e;
 
-    // band width
+    // band width (the largest band width if the band is adaptive)
     int k;
 
+    // variant of the greedy algorithm
+    greedy_mode_t greedy_mode;
+
     // maximum test number
     int max_tests;
 
-    // array of strings storing the strings for alignment
-    std::string* read;
-    std::string* ref;
+    // the data file, mapped into memory
+    mapped_dataset* dataset;
+
+    // the pair file, mapped into memory, if the data was read by read_pair_file()
+    pair_file_reader* pairs;
+
+    // the decoded strings of the pair file, for the engines that take characters
+    std::vector<char> pair_strings;
+
+    // index of the pair being aligned in the pair file, or -1 if there is no pair file
+    int current_pair;
+
+    // the benchmark whose data a worker of run_scaling() aligns, or nullptr for its own data
+    const benchmark* data_source;
+
+    // the strings for alignment, pointing into the data file
+    std::vector<std::string_view> read;
+    std::vector<std::string_view> ref;
 
     // array storing the optimal results
     int* answers;
 
-    // tms objects to record the time usage
-    tms start_time;
-    tms end_time;
-    tms nw_time, LEAP_time, greedy_time;
+    // timers recording the latency of each call
+    engine_timer nw_time, LEAP_time, greedy_time, myers_time, dp_time;
 
     // align_result_t objects to store the alignment results
-    align_result_t *nw_results, *LEAP_results, *greedy_results;
+    align_result_t *nw_results, *LEAP_results, *greedy_results, *myers_results, *dp_results;
 
     // check correctness of the algorithm
     int total_tests;
-    int nw_correct, LEAP_correct, greedy_correct;
+    int nw_correct, LEAP_correct, greedy_correct, myers_correct, dp_correct;
     int greedy_coverage;
 
+    // number of greedy alignments proven optimal by the lower bound
+    int greedy_certified;
+
+    // number of alignments that end up with each band width in greedy algorithm
+    int greedy_band_usage[MAX_K + 1];
+
+    // results of each pair in run_separate(): the penalty of every engine, and the CIGARs of
+    // NW and greedy for the coverage
+    std::vector<int> stored_penalties[NUM_ENGINES];
+    std::vector<std::string> stored_nw_CIGARs, stored_greedy_CIGARs;
+
+    // time of each trial of each engine in run_separate(), in seconds
+    std::vector<double> trial_seconds[NUM_ENGINES];
+
     /**
      * Run banded Needleman-Wunsch algorithm on two strings s1 and s2. Store the results
      * in nw_results.
@@ -109,15 +203,12 @@ private:
         parasail_result_t* result;
         parasail_cigar_t* cigar_result;
         // TODO: check what the band width is affecting
-        times(&start_time);
+        nw_time.start();
         result = parasail_nw_trace(s1, s1Len, s2, s2Len, o, e, penalty_matrix);
         cigar_result = parasail_result_get_cigar(result, s1, s1Len, s2, s2Len, penalty_matrix);
         nw_results->CIGAR = parasail_cigar_decode(cigar_result);
         nw_results->penalty = - result->score;
-        times(&end_time);
-
-        nw_time.tms_stime += end_time.tms_stime - start_time.tms_stime;
-        nw_time.tms_utime += end_time.tms_utime - start_time.tms_utime;
+        nw_time.stop();
 
         parasail_result_free(result);
         parasail_cigar_free(cigar_result);
@@ -135,15 +226,12 @@ private:
         parasail_result_t* result;
         parasail_cigar_t* cigar_result;
 
-        times(&start_time);
+        nw_time.start();
         result =  parasail_nw_trace_striped_sse41_128_16(s1, s1Len, s2, s2Len, o, e, penalty_matrix);
         cigar_result = parasail_result_get_cigar(result, s1, s1Len, s2, s2Len, penalty_matrix);
         nw_results->CIGAR = parasail_cigar_decode(cigar_result);
         nw_results->penalty = - result->score;
-        times(&end_time);
-
-        nw_time.tms_stime += end_time.tms_stime - start_time.tms_stime;
-        nw_time.tms_utime += end_time.tms_utime - start_time.tms_utime;
+        nw_time.stop();
 
         parasail_result_free(result);
         parasail_cigar_free(cigar_result);
@@ -159,10 +247,17 @@ private:
             char * s2,
             int s2Len
             ) {
-        int length = std::max(s1Len, s2Len);
+        // LEAP reads `length` characters of both strings, so the shorter one must be padded with
+        // '\0' instead of running into the next line of the mapped data file, and longer pairs
+        // are cut at MAX_LENGTH like for the other engines, to stay inside the padded copies
+        int length = std::min(std::max(s1Len, s2Len), MAX_LENGTH);
+        char s1_padded[MAX_LENGTH + 1] = {};
+        char s2_padded[MAX_LENGTH + 1] = {};
+        memcpy(s1_padded, s1, std::min(s1Len, MAX_LENGTH));
+        memcpy(s2_padded, s2, std::min(s2Len, MAX_LENGTH));
 
-        times(&start_time);
-        ed_obj->load_reads(s1, s2, length);
+        LEAP_time.start();
+        ed_obj->load_reads(s1_padded, s2_padded, length);
         //ed_obj->calculate_masks();
         ed_obj->reset();
         ed_obj->run();
@@ -172,10 +267,7 @@ private:
         }
         LEAP_results->penalty = ed_obj->get_ED();
         LEAP_results->CIGAR = ed_obj->get_CIGAR();
-        times(&end_time);
-
-        LEAP_time.tms_stime += end_time.tms_stime - start_time.tms_stime;
-        LEAP_time.tms_utime += end_time.tms_utime - start_time.tms_utime;
+        LEAP_time.stop();
     }
 
     /**
@@ -188,16 +280,88 @@ private:
             const char * s2,
             const int s2Len
     ) {
-        times(&start_time);
-        matrix->reset(s1, s1Len, s2, s2Len, k);
-        matrix->run();
+        greedy_time.start();
+        if (greedy_mode == HYBRID) {
+            greedy_results->penalty = hybrid->align(s1, s1Len, s2, s2Len);
+            greedy_results->CIGAR = hybrid->get_CIGAR();
+            greedy_certified += hybrid->get_certified();
+            greedy_band_usage[k]++;
+            greedy_time.stop();
+            return;
+        }
+        // the band passed to reset() is only a placeholder if the band is adaptive
+        int band = greedy_mode == ADAPTIVE_BAND ? 0 : k;
+        if (current_pair >= 0) {
+            // the pair file is already packed, so the characters are not encoded again
+            const pair_file_reader* pair_file = _data().pairs;
+            matrix->reset_packed(pair_file->read_packed(current_pair), s1Len,
+                                 pair_file->ref_packed(current_pair), s2Len, band);
+        } else {
+            matrix->reset(s1, s1Len, s2, s2Len, band);
+        }
+        switch (greedy_mode) {
+            case ADAPTIVE_BAND:
+                matrix->run_adaptive(1, k);
+                break;
+            case BIDIRECTIONAL:
+                matrix->run_bidirectional();
+                break;
+            case BEAM_SEARCH:
+                matrix->run_beam(BEAM_WIDTH);
+                break;
+            case POLISHED:
+                matrix->run();
+                matrix->polish();
+                break;
+            default:
+                matrix->run();
+                break;
+        }
+        greedy_certified += matrix->is_certified();
+        greedy_band_usage[matrix->get_band()]++;
         greedy_results->penalty = matrix->get_cost();
         greedy_results->CIGAR = matrix->get_CIGAR();
         //printf("%d, %s\n", greedy_results->penalty, greedy_results->CIGAR.c_str());
-        times(&end_time);
+        greedy_time.stop();
+    }
 
-        greedy_time.tms_stime += end_time.tms_stime - start_time.tms_stime;
-        greedy_time.tms_utime += end_time.tms_utime - start_time.tms_utime;
+    /**
+     * Run Myers' bit-parallel edit distance with traceback on two strings s1 and s2.
+     * Store the results in myers_results.
+     */
+    void _run_myers(
+            const char * s1,
+            const int s1Len,
+            const char * s2,
+            const int s2Len
+    ) {
+        myers_time.start();
+        myers->reset(s1, s1Len, s2, s2Len);
+        myers->run();
+        myers_results->penalty = myers->get_cost();
+        myers_results->CIGAR = myers->get_CIGAR();
+        myers_time.stop();
+    }
+
+    /**
+     * Run the banded DP on two strings s1 and s2, using the cost of the greedy algorithm as the
+     * budget. Must be run after _run_greedy(). Store the results in dp_results.
+     */
+    void _run_dp(
+            const char * s1,
+            const int s1Len,
+            const char * s2,
+            const int s2Len
+    ) {
+        dp_time.start();
+        dp->reset(s1, s1Len, s2, s2Len);
+        if (dp->run(greedy_results->penalty) != COMPLETED) {
+            // the greedy cost is not a valid bound, e.g. the greedy run was aborted
+            dp->run();
+        }
+        dp_results->penalty = dp->get_cost();
+        dp_results->CIGAR = dp->get_CIGAR();
+        dp_time.stop();
     }
 
     /**
@@ -243,6 +407,8 @@ private:
         }
         _run_LEAP(s1, s1Len, s2, s2Len);
         _run_greedy(s1, s1Len, s2, s2Len);
+        _run_myers(s1, s1Len, s2, s2Len);
+        _run_dp(s1, s1Len, s2, s2Len);
         //printf("%s\n%s\n", s1, s2);
         //printf("%d, %d\n", nw_results->penalty, greedy_results->penalty);
         // check correctness
@@ -253,11 +419,159 @@ private:
         nw_correct += (nw_results->penalty == correct_answer);
         LEAP_correct += (LEAP_results->penalty == correct_answer);
         greedy_correct += (greedy_results->penalty == correct_answer);
+        myers_correct += (myers_results->penalty == correct_answer);
+        dp_correct += (dp_results->penalty == correct_answer);
         if (_check_coverage(s1, s2, greedy_results->CIGAR, nw_results->CIGAR, 1, 3)) {
             greedy_coverage += 1;
         }
     }
 
+    engine_timer& _timer(engine_t engine) {
+        switch (engine) {
+            case ENGINE_NW: return nw_time;
+            case ENGINE_LEAP: return LEAP_time;
+            case ENGINE_GREEDY: return greedy_time;
+            case ENGINE_MYERS: return myers_time;
+            default: return dp_time;
+        }
+    }
+
+    align_result_t* _results(engine_t engine) {
+        switch (engine) {
+            case ENGINE_NW: return nw_results;
+            case ENGINE_LEAP: return LEAP_results;
+            case ENGINE_GREEDY: return greedy_results;
+            case ENGINE_MYERS: return myers_results;
+            default: return dp_results;
+        }
+    }
+
+    /**
+     * The benchmark holding the dataset and the stored results.
+     */
+    const benchmark& _data() const {
+        return data_source == nullptr ? *this : *data_source;
+    }
+
+    /**
+     * Run one engine on pair i. The DP takes the stored greedy penalty of the pair as its budget.
+     */
+    void _run_engine(engine_t engine, int i) {
+        const benchmark& data = _data();
+        auto s1 = (char*) data.read[i].data();
+        auto s2 = (char*) data.ref[i].data();
+        auto s1Len = (int) data.read[i].length();
+        auto s2Len = (int) data.ref[i].length();
+        current_pair = data.pairs != nullptr && data.pairs->is_open() ? i : -1;
+        switch (engine) {
+            case ENGINE_NW:
+                if (use_SIMD) {
+                    _run_nw_sse(s1, s1Len, s2, s2Len);
+                } else {
+                    _run_nw(s1, s1Len, s2, s2Len);
+                }
+                break;
+            case ENGINE_LEAP:
+                _run_LEAP(s1, s1Len, s2, s2Len);
+                break;
+            case ENGINE_GREEDY:
+                _run_greedy(s1, s1Len, s2, s2Len);
+                break;
+            case ENGINE_MYERS:
+                _run_myers(s1, s1Len, s2, s2Len);
+                break;
+            default:
+                greedy_results->penalty = data.stored_penalties[ENGINE_GREEDY][i];
+                _run_dp(s1, s1Len, s2, s2Len);
+                break;
+        }
+    }
+
+    /**
+     * Time of one run over the dataset: the mean of the trials of run_separate(), or the time
+     * of run().
+     */
+    double _seconds(engine_t engine) {
+        const std::vector<double>& trials = trial_seconds[engine];
+        if (trials.empty()) {
+            return _timer(engine).seconds();
+        }
+        double total = 0;
+        for (double seconds : trials) {
+            total += seconds;
+        }
+        return total / trials.size();
+    }
+
+    /**
+     * Align the dataset `num_trials` times with one engine on `num_threads` pinned threads,
+     * each with its own engine objects and a contiguous part of the pairs. Each thread builds
+     * its engines and aligns a few pairs to warm up once, outside of the timed trials, and the
+     * threads start each trial together.
+     * @param penalties the penalty of each pair.
+     * @param thread_seconds the time each thread took in the fastest trial.
+     * @return the time from the start of the first thread to the end of the last one in the
+     *         fastest trial, in seconds.
+     */
+    double _run_threads(engine_t engine, int num_threads, int num_cpus, int num_trials,
+                        std::vector<int>& penalties, std::vector<double>& thread_seconds) {
+        std::barrier ready(num_threads);
+        typedef std::vector<std::chrono::steady_clock::time_point> time_points;
+        std::vector<time_points> starts(num_trials, time_points(num_threads)), ends(starts);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; t++) {
+            threads.emplace_back([&, t] {
+                cpu_set_t cpus;
+                CPU_ZERO(&cpus);
+                CPU_SET(t % num_cpus, &cpus);
+                pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+
+                int begin = (int) ((long) max_tests * t / num_threads);
+                int end = (int) ((long) max_tests * (t + 1) / num_threads);
+                benchmark worker(x, o, e, k, 0, use_SIMD, greedy_mode);
+                worker.data_source = this;
+                for (int i = begin; i < std::min(end, begin + 100); i++) {
+                    worker._run_engine(engine, i);
+                }
+                align_result_t* results = worker._results(engine);
+
+                for (int trial = 0; trial < num_trials; trial++) {
+                    ready.arrive_and_wait();
+                    starts[trial][t] = std::chrono::steady_clock::now();
+                    for (int i = begin; i < end; i++) {
+                        worker._run_engine(engine, i);
+                        penalties[i] = results->penalty;
+                    }
+                    ends[trial][t] = std::chrono::steady_clock::now();
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        double best_seconds = 0;
+        for (int trial = 0; trial < num_trials; trial++) {
+            double seconds = std::chrono::duration<double>(*std::max_element(ends[trial].begin(), ends[trial].end()) -
+                                                           *std::min_element(starts[trial].begin(), starts[trial].end())).count();
+            if (trial == 0 || seconds < best_seconds) {
+                best_seconds = seconds;
+                for (int t = 0; t < num_threads; t++) {
+                    thread_seconds[t] = std::chrono::duration<double>(ends[trial][t] - starts[trial][t]).count();
+                }
+            }
+        }
+        return best_seconds;
+    }
+
+    /**
+     * Print one row of the latency table.
+     */
+    static void _print_latency(const char * name, const engine_timer& timer) {
+        printf("=> %-17s| %8.3f | %8.3f | %8.3f | %8.3f | %8.3f | %8.3f\n", name, timer.mean_us(),
+               timer.percentile_us(0.5), timer.percentile_us(0.9), timer.percentile_us(0.99),
+               timer.percentile_us(0.999), timer.max_us());
+    }
 
 public:
     benchmark(
@@ -266,18 +580,22 @@ public:
             int _e,
             int _k,
             int max_test_num,
-            bool _use_SIMD = true)
+            bool _use_SIMD = true,
+            greedy_mode_t _greedy_mode = FIXED_BAND)
             {
         // set scoring scheme
         x = _x;
         o = _o;
         e = _e;
         k = _k;
+        greedy_mode = _greedy_mode;
 
         // maximum alignment tests number
         max_tests = max_test_num;
-        read = new std::string[max_tests];
-        ref = new std::string[max_tests];
+        dataset = nullptr;
+        pairs = nullptr;
+        current_pair = -1;
+        data_source = nullptr;
         answers = new int[max_tests];
         std::fill_n(answers, max_tests, INT32_MIN);
 
@@ -285,72 +603,113 @@ public:
         use_SIMD = _use_SIMD;
         ed_obj = new LV;
         matrix = new hurdle_matrix<int_128bit>(GLOBAL, x, o, e);
+        myers = new myers_matrix<int_128bit>(GLOBAL, true);
+        hybrid = new hybrid_aligner<int_128bit>(k);
+        dp = new banded_dp(x, o, e);
         penalty_matrix = parasail_matrix_create("ACGT", 0, -x);
         ed_obj->init(k, 200, ED_GLOBAL, x, o, e);
 
-        // Initialize time objects
-        nw_time.tms_stime = 0;
-        nw_time.tms_utime = 0;
-        nw_time.tms_cstime = 0;
-        nw_time.tms_cutime = 0;
-
-        LEAP_time.tms_stime = 0;
-        LEAP_time.tms_utime = 0;
-        LEAP_time.tms_cstime = 0;
-        LEAP_time.tms_cutime = 0;
-
-        greedy_time.tms_stime = 0;
-        greedy_time.tms_utime = 0;
-        greedy_time.tms_cstime = 0;
-        greedy_time.tms_cutime = 0;
+        // measure the rate of the time-stamp counter before any alignment is timed
+        engine_timer::cycles_per_us();
 
         // initialize correctness record
         total_tests = 0;
-        nw_correct = LEAP_correct = greedy_correct = 0;
+        nw_correct = LEAP_correct = greedy_correct = myers_correct = dp_correct = 0;
         greedy_coverage = 0;
+        greedy_certified = 0;
+        std::fill_n(greedy_band_usage, MAX_K + 1, 0);
 
         // Initialize results
         nw_results = new align_result_t;
         LEAP_results = new align_result_t;
         greedy_results = new align_result_t;
+        myers_results = new align_result_t;
+        dp_results = new align_result_t;
 
     }
 
     /**
      * Read the file that contains read strings and reference strings,
-     * each on a separate line.
+     * each on a separate line. The file is mapped into memory, and the strings
+     * point into the mapping instead of being copied.
      * @param string_dir the directory to the file
      * @param skip_first_char true if the first character on each line is to be skipped.
      */
     void read_string_file(
             const char * string_dir,
             bool skip_first_char = true) {
-        std::ifstream string_file;
-        string_file.open(string_dir);
-        if (string_file.is_open()) {
-            std::string read_temp, ref_temp;
+        auto start = std::chrono::steady_clock::now();
+        delete dataset;
+        delete pairs;
+        pairs = nullptr;
+        dataset = new mapped_dataset(string_dir);
+        read.clear();
+        ref.clear();
+        if (dataset->is_open()) {
+            auto strip = [&](std::string_view line) {
+                return skip_first_char && !line.empty() ? line.substr(1) : line;
+            };
+            read.reserve(max_tests);
+            ref.reserve(max_tests);
             int i;
-            for (i = 0; i < max_tests; i++) {
-                if (skip_first_char) {
-                    string_file.ignore();
-                }
-                if (!getline(string_file, read_temp)) {
-                    break;
-                }
-                if (skip_first_char) {
-                    string_file.ignore();
-                }
-                getline(string_file, ref_temp);
-                read[i].assign(read_temp);
-                ref[i].assign(ref_temp);
+            for (i = 0; i < max_tests && 2 * (size_t) i + 1 < dataset->num_lines(); i++) {
+                read.push_back(strip(dataset->line(2 * i)));
+                ref.push_back(strip(dataset->line(2 * i + 1)));
             }
             max_tests = i;
-            printf("Processed data file: %s\n", string_dir);
+            printf("Processed data file: %s (%.3f s)\n", string_dir,
+                   std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
         } else {
             printf("Unable to open data file: %s\n", string_dir);
         }
     }
 
+    /**
+     * Read a pair file written by gasma-convert (see pair_file.h), with the optimal penalty
+     * scores if it has them. The greedy algorithm reads the packed strings in place; the other
+     * engines get strings decoded once here.
+     * @param pair_dir the directory to the file
+     */
+    void read_pair_file(const char * pair_dir) {
+        auto start = std::chrono::steady_clock::now();
+        delete dataset;
+        dataset = nullptr;
+        delete pairs;
+        pairs = new pair_file_reader(pair_dir);
+        read.clear();
+        ref.clear();
+        pair_strings.clear();
+        if (!pairs->is_open()) {
+            printf("Unable to open pair file: %s\n", pair_dir);
+            return;
+        }
+        max_tests = (int) std::min<size_t>(max_tests, pairs->num_pairs());
+        size_t total_length = 0;
+        for (int i = 0; i < max_tests; i++) {
+            total_length += pairs->read_length(i) + pairs->ref_length(i);
+        }
+        // the views point into this buffer, so it is not resized after this
+        pair_strings.resize(total_length);
+        read.reserve(max_tests);
+        ref.reserve(max_tests);
+        char* position = pair_strings.data();
+        for (int i = 0; i < max_tests; i++) {
+            int read_length = pairs->read_length(i);
+            int ref_length = pairs->ref_length(i);
+            decode_2bit(pairs->read_packed(i), read_length, position);
+            read.emplace_back(position, read_length);
+            position += read_length;
+            decode_2bit(pairs->ref_packed(i), ref_length, position);
+            ref.emplace_back(position, ref_length);
+            position += ref_length;
+            if (pairs->cost(i) != PAIR_FILE_NO_COST) {
+                answers[i] = pairs->cost(i);
+            }
+        }
+        printf("Processed pair file: %s (%.3f s)\n", pair_dir,
+               std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
     /**
      * Read the file containing the corresponding optimal penalty scores.
      * @param answer_dir the directory to the file
@@ -368,14 +727,15 @@ public:
     }
 
     /**
-     * Run the benchmark. Must be run after read_string_file().
+     * Run the benchmark. Must be run after read_string_file() or read_pair_file().
      */
     void run() {
         for (int i = 0; i < max_tests; i++) {
-            auto s1 = (char*) read[i].c_str();
-            auto s2 = (char*) ref[i].c_str();
+            auto s1 = (char*) read[i].data();
+            auto s2 = (char*) ref[i].data();
             auto s1Len = (int) read[i].length();
             auto s2Len = (int) ref[i].length();
+            current_pair = pairs != nullptr && pairs->is_open() ? i : -1;
             _run_benchmark(s1, s1Len, s2, s2Len, answers[i]);
             if (i % 100000 == 0 && i != 0) {
                 printf("...processed %d reads.\n", i);
@@ -385,30 +745,345 @@ public:
     }
 
     /**
-     * Print out the benchmark results. Must be run after run().
+     * Run the benchmark with one pass over the dataset per engine instead of running all the
+     * engines on each pair, so an engine does not find the caches and the branch predictors
+     * filled by the others. Each engine first aligns `num_warmup` pairs untimed, then runs
+     * `num_trials` timed passes. The results are compared afterwards. Must be run after
+     * read_string_file() or read_pair_file(), instead of run().
+     */
+    void run_separate(int num_trials = 5, int num_warmup = 10000) {
+        if (max_tests == 0 || num_trials <= 0) {
+            return;
+        }
+        for (int engine = 0; engine < NUM_ENGINES; engine++) {
+            auto id = static_cast<engine_t>(engine);
+            engine_timer& timer = _timer(id);
+            stored_penalties[engine].assign(max_tests, 0);
+            if (id == ENGINE_NW) {
+                stored_nw_CIGARs.assign(max_tests, "");
+            }
+            if (id == ENGINE_GREEDY) {
+                stored_greedy_CIGARs.assign(max_tests, "");
+            }
+            for (int i = 0; i < num_warmup; i++) {
+                _run_engine(id, i % max_tests);
+            }
+            timer.reset();
+            trial_seconds[engine].clear();
+            for (int trial = 0; trial < num_trials; trial++) {
+                // the statistics of the greedy algorithm are those of one pass
+                if (id == ENGINE_GREEDY) {
+                    greedy_certified = 0;
+                    std::fill_n(greedy_band_usage, MAX_K + 1, 0);
+                }
+                double before = timer.seconds();
+                for (int i = 0; i < max_tests; i++) {
+                    _run_engine(id, i);
+                    stored_penalties[engine][i] = _results(id)->penalty;
+                    if (id == ENGINE_NW && trial == 0) {
+                        stored_nw_CIGARs[i] = nw_results->CIGAR;
+                    }
+                    if (id == ENGINE_GREEDY && trial == 0) {
+                        stored_greedy_CIGARs[i] = greedy_results->CIGAR;
+                    }
+                }
+                trial_seconds[engine].push_back(timer.seconds() - before);
+            }
+            printf("...%s: %d trials of %d alignments.\n", engine_names[engine], num_trials, max_tests);
+        }
+
+        // compare the stored results
+        total_tests = max_tests;
+        nw_correct = LEAP_correct = greedy_correct = myers_correct = dp_correct = 0;
+        greedy_coverage = 0;
+        for (int i = 0; i < max_tests; i++) {
+            int correct_answer = answers[i] == INT32_MIN ? stored_penalties[ENGINE_NW][i] : answers[i];
+            nw_correct += stored_penalties[ENGINE_NW][i] == correct_answer;
+            LEAP_correct += stored_penalties[ENGINE_LEAP][i] == correct_answer;
+            greedy_correct += stored_penalties[ENGINE_GREEDY][i] == correct_answer;
+            myers_correct += stored_penalties[ENGINE_MYERS][i] == correct_answer;
+            dp_correct += stored_penalties[ENGINE_DP][i] == correct_answer;
+            // the lines of the data file are not null-terminated
+            std::string s1(read[i]), s2(ref[i]);
+            if (_check_coverage(s1.data(), s2.data(), stored_greedy_CIGARs[i], stored_nw_CIGARs[i], 1, 3)) {
+                greedy_coverage += 1;
+            }
+        }
+        printf("...complete.\n");
+    }
+
+    /**
+     * Measure how each engine scales with the number of threads: for 1, 2, 4, ... and
+     * `max_threads` threads, the dataset is cut into one contiguous part per thread, and each
+     * thread, pinned to its own CPU, aligns its part with its own engine objects. Reports the
+     * throughput, the parallel efficiency against one thread, the spread of the times of the
+     * threads, and the alignments whose penalty differs from the run with one thread, which
+     * would reveal state shared between the engine objects. The DP is only measured after
+     * run_separate(), as it needs the greedy penalties.
+     * @param max_threads the largest number of threads. Default: 0, i.e. one per hardware thread.
+     * @param num_trials number of runs of each number of threads; the fastest is reported.
+     */
+    void run_scaling(int max_threads = 0, int num_trials = 3) {
+        int num_cpus = std::max(1, (int) std::thread::hardware_concurrency());
+        if (max_threads <= 0) {
+            max_threads = num_cpus;
+        }
+        std::vector<int> thread_counts;
+        for (int t = 1; t < max_threads; t *= 2) {
+            thread_counts.push_back(t);
+        }
+        thread_counts.push_back(max_threads);
+
+        printf("===================== Scaling Results =====================\n");
+        printf("Alignments: %d, CPUs: %d\n", max_tests, num_cpus);
+        printf("                    | threads | alignments/s | speedup | efficiency | thread CV | slowest/fastest | differ\n");
+        for (int engine = 0; engine < NUM_ENGINES; engine++) {
+            auto id = static_cast<engine_t>(engine);
+            if (id == ENGINE_DP && (int) stored_penalties[ENGINE_GREEDY].size() < max_tests) {
+                continue;
+            }
+            std::vector<int> single_thread_penalties;
+            double single_thread_throughput = 0;
+            for (int num_threads : thread_counts) {
+                std::vector<int> penalties(max_tests);
+                std::vector<double> best_thread_seconds(num_threads);
+                double best_seconds = _run_threads(id, num_threads, num_cpus, std::max(1, num_trials),
+                                                   penalties, best_thread_seconds);
+                double throughput = max_tests / best_seconds;
+                if (num_threads == 1) {
+                    single_thread_penalties = penalties;
+                    single_thread_throughput = throughput;
+                }
+                int differ = 0;
+                for (int i = 0; i < max_tests && !single_thread_penalties.empty(); i++) {
+                    differ += penalties[i] != single_thread_penalties[i];
+                }
+                double mean = 0, variance = 0;
+                for (double seconds : best_thread_seconds) {
+                    mean += seconds / num_threads;
+                }
+                for (double seconds : best_thread_seconds) {
+                    variance += (seconds - mean) * (seconds - mean) / num_threads;
+                }
+                auto [fastest, slowest] = std::minmax_element(best_thread_seconds.begin(), best_thread_seconds.end());
+                double speedup = single_thread_throughput > 0 ? throughput / single_thread_throughput : 0;
+                printf("=> %-17s| %7d | %12.0f | %7.2f | %8.1f %% | %7.2f %% | %15.3f | %6d\n", engine_names[engine],
+                       num_threads, throughput, speedup, speedup / num_threads * 100,
+                       mean > 0 ? std::sqrt(variance) / mean * 100 : 0, *fastest > 0 ? *slowest / *fastest : 0, differ);
+            }
+        }
+    }
+
+    /**
+     * Print out the benchmark results. Must be run after run() or run_separate().
      */
     void print() {
         printf("===================== Benchmark Results =====================\n");
-        printf("Total number of alignments: %d\n[Time]\n", total_tests);
-        printf("=> Needleman-Wunsch | %.3f s\n", (double) nw_time.tms_utime / sysconf(_SC_CLK_TCK));
-        printf("=> LEAP             | %.3f s\n", (double) LEAP_time.tms_utime / sysconf(_SC_CLK_TCK));
-        printf("=> Greedy           | %.3f s\n", (double) greedy_time.tms_utime / sysconf(_SC_CLK_TCK));
+        printf("Total number of alignments: %d\n", total_tests);
+#ifdef LOOKAHEAD
+        printf("Greedy variant: lookahead with sight %d\n", SIGHT);
+#endif
+        printf("[Time]\n");
+        printf("=> Needleman-Wunsch | %.3f s\n", _seconds(ENGINE_NW));
+        printf("=> LEAP             | %.3f s\n", _seconds(ENGINE_LEAP));
+        printf("=> Greedy           | %.3f s\n", _seconds(ENGINE_GREEDY));
+        printf("=> Myers            | %.3f s\n", _seconds(ENGINE_MYERS));
+        printf("=> Greedy + DP      | %.3f s\n", _seconds(ENGINE_GREEDY) + _seconds(ENGINE_DP));
+        if (!trial_seconds[ENGINE_GREEDY].empty()) {
+            printf("[Trials] (time of one pass over %d trials)\n", (int) trial_seconds[ENGINE_GREEDY].size());
+            printf("                    |     mean |   stddev |      min |      max |     CV\n");
+            for (int engine = 0; engine < NUM_ENGINES; engine++) {
+                const std::vector<double>& trials = trial_seconds[engine];
+                double mean = _seconds(static_cast<engine_t>(engine));
+                double variance = 0;
+                for (double seconds : trials) {
+                    variance += (seconds - mean) * (seconds - mean);
+                }
+                double stddev = trials.size() > 1 ? std::sqrt(variance / (trials.size() - 1)) : 0;
+                printf("=> %-17s| %8.3f | %8.4f | %8.3f | %8.3f | %5.2f %%\n", engine_names[engine], mean, stddev,
+                       *std::min_element(trials.begin(), trials.end()),
+                       *std::max_element(trials.begin(), trials.end()), mean > 0 ? stddev / mean * 100 : 0);
+            }
+        }
+        printf("[Throughput] (alignments per second)\n");
+        printf("=> Needleman-Wunsch | %.0f\n", nw_time.throughput());
+        printf("=> LEAP             | %.0f\n", LEAP_time.throughput());
+        printf("=> Greedy           | %.0f\n", greedy_time.throughput());
+        printf("=> Myers            | %.0f\n", myers_time.throughput());
+        printf("=> Greedy + DP      | %.0f\n", total_tests / (_seconds(ENGINE_GREEDY) + _seconds(ENGINE_DP)));
+        printf("[Latency] (us per alignment)\n");
+        printf("                    |     mean |      p50 |      p90 |      p99 |    p99.9 |      max\n");
+        _print_latency("Needleman-Wunsch", nw_time);
+        _print_latency("LEAP", LEAP_time);
+        _print_latency("Greedy", greedy_time);
+        _print_latency("Myers", myers_time);
+        _print_latency("DP (after greedy)", dp_time);
         printf("[Accuracy] (percentage of alignments matching optimal penalty)\n");
         printf("=> Needleman-Wunsch | %.3f %%\n", (double) nw_correct / total_tests * 100);
         printf("=> LEAP             | %.3f %%\n", (double) LEAP_correct / total_tests * 100);
         printf("=> Greedy           | %.3f %%\n", (double) greedy_correct / total_tests * 100);
+        printf("=> Myers            | %.3f %%\n", (double) myers_correct / total_tests * 100);
+        printf("=> Greedy + DP      | %.3f %%\n", (double) dp_correct / total_tests * 100);
         printf("[Coverage] (percentage of alignments covering all long consecutive matches)\n");
         printf("=> Greedy           | %.3f %%\n", (double) greedy_coverage / total_tests * 100);
+        printf("[Certified] (percentage of alignments proven optimal without verification)\n");
+        printf("=> Greedy           | %.3f %%\n", (double) greedy_certified / total_tests * 100);
+        if (greedy_mode == HYBRID) {
+            printf("[Hybrid] (greedy with exact fallback)\n");
+            printf("=> Fallback rate    | %.3f %%\n", hybrid->get_fallback_rate() * 100);
+            printf("=> Improved by exact| %.3f %%\n", hybrid->get_improvement_rate() * 100);
+            printf("=> Time / alignment | %.3f us\n", hybrid->get_time_per_alignment() * 1e6);
+        }
+        if (greedy_mode == ADAPTIVE_BAND) {
+            printf("[Band usage] (percentage of alignments using each band width)\n");
+            for (int band = 0; band <= MAX_K; band++) {
+                if (greedy_band_usage[band] > 0) {
+                    printf("=> k = %-14d | %.3f %%\n", band, (double) greedy_band_usage[band] / total_tests * 100);
+                }
+            }
+        }
+    }
+
+    /**
+     * Count hardware events (cycles, instructions, branch and cache misses) of each engine
+     * with perf_event_open. Must be run before run(). Adds two system calls per alignment to
+     * the run time, but not to the times of the engines.
+     */
+    void enable_perf_counters() {
+        nw_time.enable_counters();
+        LEAP_time.enable_counters();
+        greedy_time.enable_counters();
+        myers_time.enable_counters();
+        dp_time.enable_counters();
+        if (!greedy_time.get_counters()->is_available()) {
+            printf("Hardware performance counters are unavailable, they will not be reported.\n");
+        }
+    }
+
+    /**
+     * Print the hardware events per alignment of each engine, and the peak memory usage. Must
+     * be run after run().
+     */
+    void print_perf_counters() {
+        if (greedy_time.get_counters() != nullptr && greedy_time.get_counters()->is_available()) {
+            printf("[Hardware counters] (per alignment)\n");
+            perf_counters::print_header();
+            nw_time.get_counters()->print("Needleman-Wunsch", nw_time.num_calls());
+            LEAP_time.get_counters()->print("LEAP", LEAP_time.num_calls());
+            greedy_time.get_counters()->print("Greedy", greedy_time.num_calls());
+            myers_time.get_counters()->print("Myers", myers_time.num_calls());
+            dp_time.get_counters()->print("DP (after greedy)", dp_time.num_calls());
+        }
+        printf("[Memory]\n");
+        printf("=> Peak RSS         | %.1f MB\n", perf_counters::peak_RSS_MB());
+    }
+
+    /**
+     * Print the latency histogram of each engine. Must be run after run().
+     */
+    void print_histograms() {
+        printf("[Latency histograms] (share of alignments in each range)\n");
+        double unit = engine_timer::cycles_per_us();
+        nw_time.get_histogram().print("Needleman-Wunsch", unit);
+        LEAP_time.get_histogram().print("LEAP", unit);
+        greedy_time.get_histogram().print("Greedy", unit);
+        myers_time.get_histogram().print("Myers", unit);
+        dp_time.get_histogram().print("DP (after greedy)", unit);
+    }
+
+    /**
+     * Add every metric of each engine to a report, under the name of the dataset, e.g. its
+     * error rate. Must be run after run() or run_separate(). The time and throughput are
+     * those of one pass, with their standard deviation over the trials of run_separate().
+     * @param report the report, which may hold the results of other datasets.
+     * @param dataset name of the dataset in the report.
+     */
+    void report(benchmark_report& report, const std::string& dataset) {
+        report.set("penalties", "x=" + std::to_string(x) + " o=" + std::to_string(o) + " e=" + std::to_string(e));
+        report.set("band_width", std::to_string(k));
+        report.set("greedy_mode", greedy_mode_names[greedy_mode]);
+        report.set("trials", std::to_string(trial_seconds[ENGINE_GREEDY].size()));
+        report.add(dataset, "", "alignments", total_tests);
+
+        const int correct[NUM_ENGINES] = {nw_correct, LEAP_correct, greedy_correct, myers_correct, dp_correct};
+        for (int engine = 0; engine < NUM_ENGINES; engine++) {
+            auto id = static_cast<engine_t>(engine);
+            const engine_timer& timer = _timer(id);
+            const char* name = engine_names[engine];
+            const std::vector<double>& trials = trial_seconds[engine];
+            double seconds = _seconds(id);
+            double stddev = NAN;
+            if (trials.size() > 1) {
+                double variance = 0;
+                for (double trial : trials) {
+                    variance += (trial - seconds) * (trial - seconds) / (trials.size() - 1);
+                }
+                stddev = std::sqrt(variance);
+            }
+            report.add(dataset, name, "time_s", seconds, stddev, (long) trials.size());
+            // the standard deviation of the throughput, to first order
+            report.add(dataset, name, "throughput", seconds > 0 ? total_tests / seconds : 0,
+                       seconds > 0 ? total_tests * stddev / (seconds * seconds) : NAN, (long) trials.size());
+            report.add(dataset, name, "latency_mean_us", timer.mean_us(), timer.stddev_us(), (long) timer.num_calls());
+            report.add(dataset, name, "latency_p50_us", timer.percentile_us(0.5));
+            report.add(dataset, name, "latency_p90_us", timer.percentile_us(0.9));
+            report.add(dataset, name, "latency_p99_us", timer.percentile_us(0.99));
+            report.add(dataset, name, "latency_p999_us", timer.percentile_us(0.999));
+            report.add(dataset, name, "latency_max_us", timer.max_us());
+            report.add(dataset, name, "accuracy_pct", total_tests > 0 ? (double) correct[engine] / total_tests * 100 : 0,
+                       NAN, total_tests);
+
+            const perf_counters* counters = timer.get_counters();
+            if (counters != nullptr && counters->is_available() && timer.num_calls() > 0) {
+                static const char* const event_names[NUM_PERF_EVENTS] = {"cycles", "instructions", "branch_misses",
+                                                                         "l1d_misses", "llc_misses"};
+                for (int event = 0; event < NUM_PERF_EVENTS; event++) {
+                    double count = counters->read(static_cast<perf_event_t>(event));
+                    if (count >= 0) {
+                        report.add(dataset, name, event_names[event], count / timer.num_calls());
+                    }
+                }
+                double cycles = counters->read(CYCLES), instructions = counters->read(INSTRUCTIONS);
+                if (cycles > 0 && instructions >= 0) {
+                    report.add(dataset, name, "ipc", instructions / cycles);
+                }
+            }
+        }
+
+        const char* greedy = engine_names[ENGINE_GREEDY];
+        report.add(dataset, greedy, "coverage_pct", total_tests > 0 ? (double) greedy_coverage / total_tests * 100 : 0,
+                   NAN, total_tests);
+        report.add(dataset, greedy, "certified_pct", total_tests > 0 ? (double) greedy_certified / total_tests * 100 : 0,
+                   NAN, total_tests);
+        if (greedy_mode == HYBRID) {
+            report.add(dataset, greedy, "fallback_pct", hybrid->get_fallback_rate() * 100, NAN, total_tests);
+            report.add(dataset, greedy, "improved_pct", hybrid->get_improvement_rate() * 100, NAN, total_tests);
+        }
+        if (greedy_mode == ADAPTIVE_BAND) {
+            for (int band = 0; band <= MAX_K; band++) {
+                if (greedy_band_usage[band] > 0) {
+                    report.add(dataset, greedy, "band_" + std::to_string(band) + "_pct",
+                               (double) greedy_band_usage[band] / total_tests * 100, NAN, total_tests);
+                }
+            }
+        }
+        report.add(dataset, "", "peak_rss_mb", perf_counters::peak_RSS_MB());
     }
 
     ~benchmark() {
         delete matrix;
+        delete myers;
+        delete hybrid;
+        delete dp;
         delete ed_obj;
+        parasail_matrix_free(penalty_matrix);
         delete nw_results;
         delete LEAP_results;
         delete greedy_results;
-        delete[] read;
-        delete[] ref;
+        delete myers_results;
+        delete dp_results;
+        delete dataset;
+        delete pairs;
         delete[] answers;
     }
 };
@@ -0,0 +1,272 @@
+#ifndef GASMA_LATENCY_HISTOGRAM_H
+#define GASMA_LATENCY_HISTOGRAM_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <x86intrin.h>
+
+#include "perf_counters.h"
+
+#define LATENCY_SUB_BUCKETS 16      // buckets per power of two, i.e. a resolution of 1/16
+
+/**
+ * Histogram of latencies (in cycles) with log-linear buckets: each power of two is cut into
+ * LATENCY_SUB_BUCKETS buckets, so percentiles are exact to about 6% over any range, and
+ * recording a value is a few instructions.
+ */
+class latency_histogram {
+protected:
+    std::vector<uint64_t> counts;
+    uint64_t total_count;
+    uint64_t total;
+    double total_squares;
+    uint64_t min_value, max_value;
+
+    static int _bucket(uint64_t value) {
+        if (value < LATENCY_SUB_BUCKETS) {
+            return (int) value;
+        }
+        int exponent = 63 - __builtin_clzll(value);     // value is in [2^exponent, 2^(exponent + 1))
+        int sub_bucket = (int) (value >> (exponent - 4)) & (LATENCY_SUB_BUCKETS - 1);
+        return (exponent - 3) * LATENCY_SUB_BUCKETS + sub_bucket;
+    }
+
+    /**
+     * The smallest value of bucket b.
+     */
+    static uint64_t _lower(int b) {
+        if (b < LATENCY_SUB_BUCKETS) {
+            return b;
+        }
+        int exponent = b / LATENCY_SUB_BUCKETS + 3;
+        return (uint64_t) (LATENCY_SUB_BUCKETS + b % LATENCY_SUB_BUCKETS) << (exponent - 4);
+    }
+
+public:
+    latency_histogram() : counts(61 * LATENCY_SUB_BUCKETS, 0) {
+        reset();
+    }
+
+    void reset() {
+        std::fill(counts.begin(), counts.end(), 0);
+        total_count = total = max_value = 0;
+        total_squares = 0;
+        min_value = UINT64_MAX;
+    }
+
+    void record(uint64_t value) {
+        counts[_bucket(value)]++;
+        total_count++;
+        total += value;
+        total_squares += (double) value * value;
+        min_value = std::min(min_value, value);
+        max_value = std::max(max_value, value);
+    }
+
+    uint64_t count() const {
+        return total_count;
+    }
+
+    uint64_t sum() const {
+        return total;
+    }
+
+    double mean() const {
+        return total_count == 0 ? 0 : (double) total / total_count;
+    }
+
+    /**
+     * Sample standard deviation of the values.
+     */
+    double stddev() const {
+        if (total_count < 2) {
+            return 0;
+        }
+        double variance = (total_squares - (double) total * total / total_count) / (total_count - 1);
+        return std::sqrt(std::max(0.0, variance));
+    }
+
+    uint64_t min() const {
+        return total_count == 0 ? 0 : min_value;
+    }
+
+    uint64_t max() const {
+        return max_value;
+    }
+
+    /**
+     * Return the value below which a fraction p of the values are, as the middle of its bucket.
+     * @param p between 0 and 1.
+     */
+    double percentile(double p) const {
+        if (total_count == 0) {
+            return 0;
+        }
+        auto rank = (uint64_t) std::max(1.0, std::ceil(p * total_count));
+        uint64_t seen = 0;
+        for (int b = 0; b < (int) counts.size(); b++) {
+            seen += counts[b];
+            if (seen >= rank) {
+                double middle = (_lower(b) + _lower(b + 1)) / 2.0;
+                return std::clamp(middle, (double) min_value, (double) max_value);
+            }
+        }
+        return (double) max_value;
+    }
+
+    /**
+     * Print the histogram with one row per power of two, scaled by `unit` values per
+     * microsecond, with a bar proportional to the share of the values in the row.
+     */
+    void print(const char* name, double unit) const {
+        printf("=> %s\n", name);
+        int num_rows = 64 - __builtin_clzll(std::max<uint64_t>(max_value, 1));
+        for (int row = std::max(0, 63 - __builtin_clzll(std::max<uint64_t>(min(), 1))); row < num_rows; row++) {
+            uint64_t lower = (uint64_t) 1 << row, upper = lower << 1;
+            uint64_t in_row = 0;
+            for (int b = _bucket(lower); b < (int) counts.size() && _lower(b) < upper; b++) {
+                in_row += counts[b];
+            }
+            if (row == 0) {
+                in_row += counts[0];
+            }
+            double share = total_count == 0 ? 0 : (double) in_row / total_count;
+            printf("   %9.3f - %9.3f us | %7.3f %% %s\n", lower / unit, upper / unit, share * 100,
+                   std::string((size_t) (share * 50 + 0.5), '#').c_str());
+        }
+    }
+};
+
+
+/**
+ * Times the calls of one engine with the time-stamp counter, which costs a few nanoseconds
+ * per call instead of a clock tick of resolution for times(). Every call is recorded in a
+ * latency_histogram, and the total time is the sum of the calls. Hardware counters can be
+ * attached, which count the calls only (not the timing), at the cost of two system calls per call.
+ */
+class engine_timer {
+protected:
+    uint64_t start_cycles;
+    latency_histogram histogram;
+    perf_counters* counters;
+
+public:
+    engine_timer() {
+        start_cycles = 0;
+        counters = nullptr;
+    }
+
+    engine_timer(const engine_timer&) = delete;
+    engine_timer& operator=(const engine_timer&) = delete;
+
+    /**
+     * Count hardware events during the calls with a new group of counters.
+     */
+    void enable_counters() {
+        if (counters == nullptr) {
+            counters = new perf_counters;
+        }
+    }
+
+    /**
+     * Return the attached counters, or nullptr if enable_counters() was not called.
+     */
+    const perf_counters* get_counters() const {
+        return counters;
+    }
+
+    /**
+     * Number of time-stamp counter cycles per microsecond, measured once against steady_clock.
+     */
+    static double cycles_per_us() {
+        static const double rate = [] {
+            auto start = std::chrono::steady_clock::now();
+            uint64_t start_tsc = __rdtsc();
+            while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(20)) {}
+            uint64_t cycles = __rdtsc() - start_tsc;
+            return cycles / (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e6);
+        }();
+        return rate;
+    }
+
+    void start() {
+        if (counters != nullptr) {
+            counters->start();
+        }
+        _mm_lfence();
+        start_cycles = __rdtsc();
+    }
+
+    void stop() {
+        unsigned int processor;
+        uint64_t end_cycles = __rdtscp(&processor);
+        _mm_lfence();
+        if (counters != nullptr) {
+            counters->stop();
+        }
+        histogram.record(end_cycles - start_cycles);
+    }
+
+    /**
+     * Forget the recorded calls and zero the attached counters.
+     */
+    void reset() {
+        histogram.reset();
+        if (counters != nullptr) {
+            counters->reset();
+        }
+    }
+
+    const latency_histogram& get_histogram() const {
+        return histogram;
+    }
+
+    uint64_t num_calls() const {
+        return histogram.count();
+    }
+
+    /**
+     * Total time of the calls, in seconds.
+     */
+    double seconds() const {
+        return histogram.sum() / cycles_per_us() / 1e6;
+    }
+
+    /**
+     * Calls per second.
+     */
+    double throughput() const {
+        return histogram.sum() == 0 ? 0 : num_calls() / seconds();
+    }
+
+    /**
+     * Latency at fraction p of the calls, in microseconds.
+     */
+    double percentile_us(double p) const {
+        return histogram.percentile(p) / cycles_per_us();
+    }
+
+    double mean_us() const {
+        return histogram.mean() / cycles_per_us();
+    }
+
+    double stddev_us() const {
+        return histogram.stddev() / cycles_per_us();
+    }
+
+    double max_us() const {
+        return histogram.max() / cycles_per_us();
+    }
+
+    ~engine_timer() {
+        delete counters;
+    }
+};
+
+
+#endif //GASMA_LATENCY_HISTOGRAM_H
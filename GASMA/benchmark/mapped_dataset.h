@@ -0,0 +1,151 @@
+#ifndef GASMA_MAPPED_DATASET_H
+#define GASMA_MAPPED_DATASET_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+ * A text file mapped into memory (read-only) and split into lines, without copying any line,
+ * so the memory used is the page cache of the file plus one string_view per line. The line
+ * breaks are searched by several threads, each on its own part of the file. The lines are not
+ * null-terminated.
+ */
+class mapped_dataset {
+protected:
+    char* data;
+    size_t size;
+
+    // the lines, pointing into the mapping
+    std::vector<std::string_view> lines;
+
+    /**
+     * Return the offsets of the line breaks in data[begin, end).
+     */
+    std::vector<size_t> _split(size_t begin, size_t end) {
+        std::vector<size_t> breaks;
+        char* position = data + begin;
+        char* stop = data + end;
+        while (position < stop) {
+            auto line_break = static_cast<char*>(memchr(position, '\n', stop - position));
+            if (line_break == nullptr) {
+                break;
+            }
+            breaks.push_back(line_break - data);
+            position = line_break + 1;
+        }
+        return breaks;
+    }
+
+    /**
+     * Add the line data[begin, end), without a trailing '\r'.
+     */
+    void _add_line(size_t begin, size_t end) {
+        if (end > begin && data[end - 1] == '\r') {
+            end--;
+        }
+        lines.emplace_back(data + begin, end - begin);
+    }
+
+public:
+    /**
+     * Map the file and find its lines.
+     * @param path the path of the file.
+     * @param num_threads number of threads that search the line breaks. Default: 0, i.e. one
+     *                    per hardware thread.
+     */
+    explicit mapped_dataset(const char* path, int num_threads = 0) {
+        data = nullptr;
+        size = 0;
+        int file = open(path, O_RDONLY);
+        if (file < 0) {
+            return;
+        }
+        struct stat status{};
+        if (fstat(file, &status) != 0 || status.st_size == 0) {
+            close(file);
+            return;
+        }
+        size = status.st_size;
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, file, 0);
+        close(file);
+        if (mapping == MAP_FAILED) {
+            size = 0;
+            return;
+        }
+        data = static_cast<char*>(mapping);
+
+        if (num_threads <= 0) {
+            num_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        }
+        // no less than 1 MB per thread
+        num_threads = static_cast<int>(std::max<size_t>(1, std::min<size_t>(num_threads, size >> 20)));
+        std::vector<std::vector<size_t>> breaks(num_threads);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; t++) {
+            threads.emplace_back([&, t] {
+                breaks[t] = _split(size * t / num_threads, size * (t + 1) / num_threads);
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        size_t num_breaks = 0;
+        for (auto& part : breaks) {
+            num_breaks += part.size();
+        }
+        lines.reserve(num_breaks + 1);
+        size_t line_begin = 0;
+        for (auto& part : breaks) {
+            for (size_t line_break : part) {
+                _add_line(line_begin, line_break);
+                line_begin = line_break + 1;
+            }
+        }
+        if (line_begin < size) {
+            _add_line(line_begin, size);
+        }
+    }
+
+    mapped_dataset(const mapped_dataset&) = delete;
+    mapped_dataset& operator=(const mapped_dataset&) = delete;
+
+    /**
+     * Check whether the file was mapped.
+     */
+    bool is_open() const {
+        return data != nullptr;
+    }
+
+    /**
+     * Return the number of lines.
+     */
+    size_t num_lines() const {
+        return lines.size();
+    }
+
+    /**
+     * Return line i, without the line break.
+     */
+    std::string_view line(size_t i) const {
+        return lines[i];
+    }
+
+    ~mapped_dataset() {
+        if (data != nullptr) {
+            munmap(data, size);
+        }
+    }
+};
+
+
+#endif //GASMA_MAPPED_DATASET_H
@@ -0,0 +1,379 @@
+/**
+ * Microbenchmark of the bit-vector primitives of utils.h (shifts, first_one, pop_count_between,
+ * flip_short_hurdles) on each width of bit vector, of the conversion of bases into bits
+ * (sse3_convert2bit1, split_2bit_packed), and of the popcount and shift kernels of LEAP.
+ *
+ * Each primitive is called on a table of NUM_INPUTS inputs of a data pattern (and shift
+ * amounts or intervals), so the calls are independent: the times are throughputs, including
+ * the load of the operand and the store of the result. The time of a call is the best (and
+ * the median) of several repetitions of `num_calls` calls, timed with the time-stamp counter.
+ *
+ *     gasma-microbenchmark                      every primitive
+ *     gasma-microbenchmark -f shift -o out.csv  the shifts only, also written for gasma-compare
+ */
+
+#include <getopt.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../utils.h"
+#include "benchmark_report.h"
+#include "latency_histogram.h"
+
+#include "LEAP_SIMD/popcount.h"
+#include "LEAP_SIMD/shift.h"
+// LEAP defines __aligned for its own declarations, keep it from reaching the standard headers
+#undef __aligned
+
+#define NUM_INPUTS 256      // inputs of each data pattern, a power of two
+
+/**
+ * The primitives on a single uint64_t, as the reference for the vector widths: the shifts
+ * are single instructions, and first_one and pop_count_between have no loop.
+ */
+class int_64bit {
+private:
+    uint64_t val;
+
+public:
+    static constexpr int width = 64;
+
+    int_64bit() {
+        val = 1;
+    }
+
+    int_64bit(uint64_t that) {
+        val = that;
+    }
+
+    int_64bit(const uint8_t * that) {
+        memcpy(&val, that, sizeof(val));
+    }
+
+    int_64bit _or(const int_64bit &that) {
+        return val | that.val;
+    }
+
+    int_64bit _and(const int_64bit &that) {
+        return val & that.val;
+    }
+
+    // bit i moves to bit i + shift_num, as in int_128bit
+    int_64bit shift_right(int shift_num) {
+        return shift_num >= 64 ? 0 : val << shift_num;
+    }
+
+    int_64bit shift_left(int shift_num) {
+        return shift_num >= 64 ? 0 : val >> shift_num;
+    }
+
+    int first_one() {
+        return static_cast<int>(_tzcnt_u64(val));
+    }
+
+    int_64bit flip_short_hurdles(int threshold) {
+        int_64bit mask_1 = shift_left(1)._or(shift_right(1));
+        if (threshold > 1) {
+            return _and(shift_left(2)._or(shift_right(2))._or(mask_1));
+        }
+        return _and(mask_1);
+    }
+
+    int pop_count_between(int from = 0, int to = 64) {
+        return static_cast<int>(_mm_popcnt_u64(shift_left(from).shift_right(from + 64 - to).val));
+    }
+};
+
+struct options_t {
+    int num_calls = 1 << 16;
+    int repetitions = 15;
+    const char* filter = nullptr;
+    const char* output = nullptr;
+};
+
+static options_t options;
+static benchmark_report report;
+
+/**
+ * Keep the compiler from removing a computation whose result is not used.
+ */
+template <typename T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * Time `call(i)` for i in [0, NUM_INPUTS) repeatedly, then print and report the time per call.
+ * @param backend the width of the bit vectors, or the family of the kernel.
+ * @param primitive the function timed.
+ * @param variant the data pattern, shift amount or interval.
+ */
+template <typename F>
+static void measure(const char* backend, const char* primitive, const std::string& variant, F&& call) {
+    if (options.filter != nullptr && strstr(primitive, options.filter) == nullptr) {
+        return;
+    }
+    std::vector<double> cycles;
+    for (int repetition = -1; repetition < options.repetitions; repetition++) {
+        _mm_lfence();
+        uint64_t start = __rdtsc();
+        for (int i = 0; i < options.num_calls; i++) {
+            call(i & (NUM_INPUTS - 1));
+        }
+        unsigned int processor;
+        uint64_t end = __rdtscp(&processor);
+        _mm_lfence();
+        // the first repetition warms up the caches and the branch predictors
+        if (repetition >= 0) {
+            cycles.push_back((double) (end - start) / options.num_calls);
+        }
+    }
+    std::sort(cycles.begin(), cycles.end());
+    double best = cycles.front(), median = cycles[cycles.size() / 2];
+    double ns_per_cycle = 1000 / engine_timer::cycles_per_us();
+    printf("%-10s | %-20s | %-12s | %8.2f | %8.2f | %8.3f\n", backend, primitive, variant.c_str(), best, median,
+           median * ns_per_cycle);
+
+    double mean = 0, variance = 0;
+    for (double c : cycles) {
+        mean += c * ns_per_cycle / cycles.size();
+    }
+    for (double c : cycles) {
+        variance += (c * ns_per_cycle - mean) * (c * ns_per_cycle - mean) / (cycles.size() - 1);
+    }
+    report.add(std::string(primitive) + " " + variant, backend, "ns_per_call", mean, std::sqrt(variance),
+               (long) cycles.size());
+}
+
+/**
+ * NUM_INPUTS inputs of 512 bits of a data pattern, each aligned for any width.
+ * random: each bit set with probability 1/2.
+ * sparse: each bit set with probability 1/20, as the mismatches of a read with 5% errors.
+ * high: random bits in the highest 64 bits of the vector only, so scans go through all words.
+ * zero: no bit set.
+ */
+struct alignas(64) input_bits {
+    uint8_t bytes[64];
+};
+
+static std::vector<input_bits> make_pattern(const std::string& pattern, int width, std::mt19937_64& rng) {
+    std::vector<input_bits> inputs(NUM_INPUTS);
+    std::bernoulli_distribution sparse(0.05);
+    for (input_bits& input : inputs) {
+        uint64_t words[8] = {0};
+        for (int word = 0; word < 8; word++) {
+            if (pattern == "random" || (pattern == "high" && word == width / 64 - 1)) {
+                words[word] = rng();
+            } else if (pattern == "sparse") {
+                for (int bit = 0; bit < 64; bit++) {
+                    words[word] |= (uint64_t) sparse(rng) << bit;
+                }
+            }
+        }
+        memcpy(input.bytes, words, sizeof(words));
+    }
+    return inputs;
+}
+
+template <typename T>
+static void run_backend(const char* backend) {
+    const int width = T::width;
+    std::mt19937_64 rng(2022);
+
+    std::vector<T> values;
+    auto load = [&](const std::string& pattern) {
+        values.clear();
+        for (const input_bits& input : make_pattern(pattern, width, rng)) {
+            values.emplace_back(input.bytes);
+        }
+    };
+
+    // shifts: fixed amounts around the word boundaries, and random amounts defeating the
+    // prediction of the branches on the amount
+    load("random");
+    std::vector<int> amounts;
+    for (int amount : {1, 2, 63, 64, 65, 127, 128, 129, 192, 255, 256, 257, 384, 511}) {
+        if (amount < width) {
+            amounts.push_back(amount);
+        }
+    }
+    std::vector<int> shifts(NUM_INPUTS);
+    for (int amount : amounts) {
+        measure(backend, "shift_left", "s=" + std::to_string(amount), [&](int i) {
+            do_not_optimize(values[i].shift_left(amount));
+        });
+        measure(backend, "shift_right", "s=" + std::to_string(amount), [&](int i) {
+            do_not_optimize(values[i].shift_right(amount));
+        });
+    }
+    std::uniform_int_distribution<int> amount(1, width - 1);
+    std::generate(shifts.begin(), shifts.end(), [&] { return amount(rng); });
+    measure(backend, "shift_left", "s=mixed", [&](int i) {
+        do_not_optimize(values[i].shift_left(shifts[i]));
+    });
+    measure(backend, "shift_right", "s=mixed", [&](int i) {
+        do_not_optimize(values[i].shift_right(shifts[i]));
+    });
+
+    // pop_count_between: the whole vector, and random intervals
+    std::vector<std::pair<int, int>> intervals(NUM_INPUTS);
+    for (auto& interval : intervals) {
+        int from = std::uniform_int_distribution<int>(0, width - 1)(rng);
+        interval = {from, std::uniform_int_distribution<int>(from + 1, width)(rng)};
+    }
+    measure(backend, "pop_count_between", "full", [&](int i) {
+        do_not_optimize(values[i].pop_count_between(0, width));
+    });
+    measure(backend, "pop_count_between", "mixed", [&](int i) {
+        do_not_optimize(values[i].pop_count_between(intervals[i].first, intervals[i].second));
+    });
+
+    // first_one and flip_short_hurdles depend on the data
+    for (const char* pattern : {"random", "sparse", "high", "zero"}) {
+        load(pattern);
+        measure(backend, "first_one", pattern, [&](int i) {
+            do_not_optimize(values[i].first_one());
+        });
+        if (strcmp(pattern, "random") == 0 || strcmp(pattern, "sparse") == 0) {
+            measure(backend, "flip_short_hurdles", std::string(pattern) + " t=1", [&](int i) {
+                do_not_optimize(values[i].flip_short_hurdles(1));
+            });
+            measure(backend, "flip_short_hurdles", std::string(pattern) + " t=2", [&](int i) {
+                do_not_optimize(values[i].flip_short_hurdles(2));
+            });
+        }
+    }
+}
+
+/**
+ * Conversion of MAX_LENGTH bases into the two bit arrays of the engine, from characters (which
+ * sse3_convert2bit1 overwrites, so the characters are copied first, as in hurdle_matrix) or
+ * from 2-bit packed bases.
+ */
+static void run_convert() {
+    std::mt19937_64 rng(2022);
+    struct alignas(16) bases {
+        char characters[MAX_LENGTH];
+        uint8_t packed[MAX_LENGTH / 4];
+    };
+    std::vector<bases> inputs(NUM_INPUTS);
+    for (bases& input : inputs) {
+        memset(input.packed, 0, sizeof(input.packed));
+        for (int i = 0; i < MAX_LENGTH; i++) {
+            int base = (int) (rng() & 3);
+            input.characters[i] = "ACGT"[base];
+            input.packed[i / 4] |= base << (2 * (i % 4));
+        }
+    }
+    alignas(16) char scratch[MAX_LENGTH];
+    uint8_t bits0[MAX_LENGTH / 8] GASMA_ALIGNED;
+    uint8_t bits1[MAX_LENGTH / 8] GASMA_ALIGNED;
+
+    std::string variant = std::to_string(MAX_LENGTH) + " bases";
+    measure("convert", "copy only", variant, [&](int i) {
+        memcpy(scratch, inputs[i].characters, MAX_LENGTH);
+        do_not_optimize(scratch);
+    });
+    measure("convert", "sse3_convert2bit1", variant, [&](int i) {
+        memcpy(scratch, inputs[i].characters, MAX_LENGTH);
+        sse3_convert2bit1(scratch, bits0, bits1);
+        do_not_optimize(bits0);
+        do_not_optimize(bits1);
+    });
+    measure("convert", "split_2bit_packed", variant, [&](int i) {
+        split_2bit_packed(inputs[i].packed, MAX_LENGTH, bits0, bits1);
+        do_not_optimize(bits0);
+        do_not_optimize(bits1);
+    });
+}
+
+/**
+ * The popcount and shift kernels of LEAP, on the same patterns as the bit vectors.
+ */
+static void run_LEAP() {
+    std::mt19937_64 rng(2022);
+    std::vector<input_bits> inputs = make_pattern("random", 256, rng);
+    std::vector<int> shifts(NUM_INPUTS);
+    std::uniform_int_distribution<int> amount(1, 127);
+    std::generate(shifts.begin(), shifts.end(), [&] { return amount(rng); });
+    auto sse = [&](int i) { return _mm_load_si128((const __m128i*) inputs[i].bytes); };
+    auto avx = [&](int i) { return _mm256_load_si256((const __m256i*) inputs[i].bytes); };
+
+    measure("LEAP", "popcount_m128i_sse", "random", [&](int i) { do_not_optimize(popcount_m128i_sse(sse(i))); });
+    measure("LEAP", "popcount_SHD_sse", "random", [&](int i) { do_not_optimize(popcount_SHD_sse(sse(i))); });
+    measure("LEAP", "popcount_m256i_avx", "random", [&](int i) { do_not_optimize(popcount_m256i_avx(avx(i))); });
+    measure("LEAP", "popcount_SHD_avx", "random", [&](int i) { do_not_optimize(popcount_SHD_avx(avx(i))); });
+    measure("LEAP", "popcount", "64 bytes", [&](int i) { do_not_optimize(popcount(inputs[i].bytes, 4)); });
+    measure("LEAP", "builtin_popcount", "64 bytes", [&](int i) {
+        do_not_optimize(builtin_popcount(inputs[i].bytes, 4));
+    });
+    for (int s : {1, 64, 65}) {
+        measure("LEAP", "shift_left_sse", "s=" + std::to_string(s), [&](int i) {
+            do_not_optimize(shift_left_sse(sse(i), s));
+        });
+        measure("LEAP", "shift_right_sse", "s=" + std::to_string(s), [&](int i) {
+            do_not_optimize(shift_right_sse(sse(i), s));
+        });
+    }
+    measure("LEAP", "shift_left_sse", "s=mixed", [&](int i) { do_not_optimize(shift_left_sse(sse(i), shifts[i])); });
+    measure("LEAP", "shift_right_sse", "s=mixed", [&](int i) { do_not_optimize(shift_right_sse(sse(i), shifts[i])); });
+    measure("LEAP", "shift_left_avx", "s=mixed", [&](int i) { do_not_optimize(shift_left_avx(avx(i), shifts[i])); });
+    measure("LEAP", "shift_right_avx", "s=mixed", [&](int i) { do_not_optimize(shift_right_avx(avx(i), shifts[i])); });
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "Time the bit-vector primitives on each width, and the conversion and LEAP kernels.\n"
+            "  -n INT   calls per repetition (default: 65536)\n"
+            "  -r INT   repetitions, of which the best and the median are reported (default: 15)\n"
+            "  -f TEXT  only the primitives whose name contains TEXT\n"
+            "  -o FILE  also write the results as CSV, to be compared with gasma-compare\n"
+            "  -h       print this help\n",
+            program);
+}
+
+int main(int argc, char** argv) {
+    int option;
+    while ((option = getopt(argc, argv, "n:r:f:o:h")) != -1) {
+        switch (option) {
+            case 'n': options.num_calls = atoi(optarg); break;
+            case 'r': options.repetitions = atoi(optarg); break;
+            case 'f': options.filter = optarg; break;
+            case 'o': options.output = optarg; break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (optind != argc || options.num_calls <= 0 || options.repetitions < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    printf("CPU: %s, time-stamp counter: %.0f MHz\n", report.get("cpu").c_str(), engine_timer::cycles_per_us());
+    printf("backend    | primitive            | variant      |   best   |  median  | median\n");
+    printf("           |                      |              | (cycles) | (cycles) |  (ns)\n");
+    run_backend<int_64bit>("uint64");
+    run_backend<int_128bit>("int_128bit");
+    run_backend<int_256bit>("int_256bit");
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+    run_backend<int_512bit>("int_512bit");
+#endif
+    run_convert();
+    run_LEAP();
+
+    if (options.output != nullptr && !report.write_csv(options.output)) {
+        fprintf(stderr, "gasma-microbenchmark: unable to write output file: %s\n", options.output);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,172 @@
+#ifndef GASMA_PERF_COUNTERS_H
+#define GASMA_PERF_COUNTERS_H
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+/**
+ * Hardware events counted for each engine.
+ */
+enum perf_event_t {
+    CYCLES,
+    INSTRUCTIONS,
+    BRANCH_MISSES,
+    L1D_MISSES,
+    LLC_MISSES,
+    NUM_PERF_EVENTS
+};
+
+/**
+ * A group of hardware performance counters (perf_event_open) of the calling thread, counting
+ * user-space events only while enabled by start() and stop(), so one group per engine counts
+ * the calls of that engine alone even if the engines are interleaved.
+ *
+ * Counters that cannot be opened (no PMU in a virtual machine, perf_event_paranoid, seccomp)
+ * are unavailable and reported as such; the benchmark runs the same without them. If the
+ * kernel multiplexes the counters, the counts are scaled by the share of time they ran.
+ */
+class perf_counters {
+protected:
+    int fds[NUM_PERF_EVENTS];
+
+    // file descriptor of the group leader, -1 if no counter is available
+    int leader;
+
+    static int _open(uint32_t type, uint64_t config, int group) {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = group == -1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return (int) syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+    }
+
+public:
+    perf_counters() {
+        static const uint32_t types[NUM_PERF_EVENTS] = {
+                PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE
+        };
+        static const uint64_t configs[NUM_PERF_EVENTS] = {
+                PERF_COUNT_HW_CPU_CYCLES,
+                PERF_COUNT_HW_INSTRUCTIONS,
+                PERF_COUNT_HW_BRANCH_MISSES,
+                PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+                PERF_COUNT_HW_CACHE_MISSES
+        };
+        leader = -1;
+        for (int event = 0; event < NUM_PERF_EVENTS; event++) {
+            fds[event] = _open(types[event], configs[event], leader);
+            if (leader == -1) {
+                leader = fds[event];
+            }
+        }
+    }
+
+    perf_counters(const perf_counters&) = delete;
+    perf_counters& operator=(const perf_counters&) = delete;
+
+    /**
+     * Check whether any counter is available.
+     */
+    bool is_available() const {
+        return leader != -1;
+    }
+
+    bool is_available(perf_event_t event) const {
+        return fds[event] != -1;
+    }
+
+    void start() {
+        if (leader != -1) {
+            ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+    void stop() {
+        if (leader != -1) {
+            ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+    void reset() {
+        if (leader != -1) {
+            ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+    /**
+     * Return the count of an event, or -1 if it is unavailable.
+     */
+    double read(perf_event_t event) const {
+        if (fds[event] == -1) {
+            return -1;
+        }
+        uint64_t values[3];     // value, time enabled, time running
+        if (::read(fds[event], values, sizeof(values)) != (ssize_t) sizeof(values)) {
+            return -1;
+        }
+        if (values[2] == 0) {
+            return values[1] == 0 ? 0 : -1;
+        }
+        return (double) values[0] * values[1] / values[2];
+    }
+
+    /**
+     * Print a row of the counters divided by the number of alignments, "n/a" for those that
+     * are unavailable.
+     */
+    void print(const char* name, uint64_t num_alignments) const {
+        printf("=> %-17s|", name);
+        double cycles = read(CYCLES), instructions = read(INSTRUCTIONS);
+        for (int event = 0; event < NUM_PERF_EVENTS; event++) {
+            double count = read(static_cast<perf_event_t>(event));
+            if (count < 0 || num_alignments == 0) {
+                printf(" %9s |", "n/a");
+            } else {
+                printf(" %9.1f |", count / num_alignments);
+            }
+        }
+        if (cycles > 0 && instructions >= 0) {
+            printf(" %5.2f\n", instructions / cycles);
+        } else {
+            printf(" %5s\n", "n/a");
+        }
+    }
+
+    /**
+     * Print the header of the rows of print().
+     */
+    static void print_header() {
+        printf("                    |    cycles |    instr. | br. miss. |  L1D miss |  LLC miss |   IPC\n");
+    }
+
+    /**
+     * Return the peak resident set size of the process, in MB.
+     */
+    static double peak_RSS_MB() {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss / 1024.0;
+    }
+
+    ~perf_counters() {
+        for (int fd : fds) {
+            if (fd != -1) {
+                close(fd);
+            }
+        }
+    }
+};
+
+
+#endif //GASMA_PERF_COUNTERS_H
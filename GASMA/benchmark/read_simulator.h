@@ -0,0 +1,415 @@
+#ifndef GASMA_READ_SIMULATOR_H
+#define GASMA_READ_SIMULATOR_H
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../utils.h"
+#include "benchmark_dataset.h"
+
+#define MAX_HOMOPOLYMER 16      // longer homopolymers have the indel rates of this length
+
+/**
+ * Parameters of a sequencing error model. A read is simulated from a random reference: the
+ * reference is walked base by base, and at each base a deletion, an insertion, a substitution
+ * or a match is drawn. Profiles are plain values, so a model is plugged in by filling the
+ * fields, by one of the presets (illumina(), nanopore()) or by learning it from the CIGARs of
+ * real alignments (from_CIGARs()).
+ */
+struct error_profile {
+    // read length, normal if length_sd > 0, clamped to [min_length, max_length]
+    int length_mean = 100;
+    double length_sd = 0;
+    int min_length = 1;
+    int max_length = MAX_LENGTH;
+
+    // longest reference; the read ends early where its reference would grow longer, so that
+    // the engines, which align at most MAX_LENGTH characters of each string, see whole pairs
+    int max_ref_length = MAX_LENGTH;
+
+    // empirical read lengths, weight of each length; replaces the normal distribution if not empty
+    std::vector<double> length_weights;
+
+    // probability that a reference base repeats the previous one (0.25 for uniform bases)
+    double repeat_rate = 0.25;
+
+    // probability per reference base of a substitution, of an insertion before it and of a
+    // deletion starting at it
+    double substitution_rate = 0.01;
+    double insertion_rate = 0.001;
+    double deletion_rate = 0.001;
+
+    // the error rates at the end of the read are (1 + position_slope) times those at the start
+    double position_slope = 0;
+
+    // indel rates inside a homopolymer of length h are multiplied by homopolymer_factor^(h - 1),
+    // at most max_homopolymer_factor, and inserted bases repeat the homopolymer
+    double homopolymer_factor = 1;
+    double max_homopolymer_factor = 8;
+
+    // indel lengths: geometric, extended with probability indel_extend, unless empirical
+    // lengths (weight of each length, index 0 unused) are given
+    double indel_extend = 0;
+    std::vector<double> insertion_lengths, deletion_lengths;
+
+    // probability per read of one long gap, inserted or deleted, of length in [min, max]
+    double long_gap_rate = 0;
+    int long_gap_min = 10;
+    int long_gap_max = 30;
+
+    /**
+     * Short reads with mostly substitutions, becoming more frequent along the read.
+     */
+    static error_profile illumina(int length = 100) {
+        error_profile profile;
+        profile.length_mean = length;
+        profile.min_length = profile.max_length = length;
+        profile.substitution_rate = 0.005;
+        profile.insertion_rate = 0.0002;
+        profile.deletion_rate = 0.0002;
+        profile.position_slope = 3;
+        profile.homopolymer_factor = 1.5;
+        return profile;
+    }
+
+    /**
+     * Nanopore-like reads: variable length, frequent indels concentrated in homopolymers, and
+     * occasional long gaps. Deletions make the reference longer than the read, so both are
+     * limited to `max_length`; with a max_length above MAX_LENGTH, the pairs are only aligned
+     * in part by the engines of this repository.
+     */
+    static error_profile nanopore(int length = 100, int max_length = MAX_LENGTH) {
+        error_profile profile;
+        profile.length_mean = length;
+        profile.length_sd = length * 0.2;
+        profile.min_length = std::max(1, length / 2);
+        profile.max_length = profile.max_ref_length = max_length;
+        profile.repeat_rate = 0.35;
+        profile.substitution_rate = 0.025;
+        profile.insertion_rate = 0.006;
+        profile.deletion_rate = 0.01;
+        profile.homopolymer_factor = 1.6;
+        profile.max_homopolymer_factor = 6;
+        profile.indel_extend = 0.2;
+        profile.long_gap_rate = 0.05;
+        return profile;
+    }
+
+    /**
+     * Learn the rates, the indel lengths and the read lengths from the CIGARs of real
+     * alignments. Substitutions are only seen in =/X CIGARs; M counts as a match. The
+     * homopolymer bias cannot be seen without the sequences and is left at 1.
+     */
+    static error_profile from_CIGARs(const std::vector<std::string>& CIGARs) {
+        error_profile profile;
+        double ref_bases = 0, substitutions = 0, insertions = 0, deletions = 0;
+        for (const std::string& CIGAR : CIGARs) {
+            int read_length = 0, length = 0;
+            for (char c : CIGAR) {
+                if (isdigit(c)) {
+                    length = length * 10 + (c - '0');
+                    continue;
+                }
+                switch (c) {
+                    case 'X':
+                        substitutions += length;
+                        [[fallthrough]];
+                    case 'M': case '=':
+                        ref_bases += length;
+                        read_length += length;
+                        break;
+                    case 'I':
+                        insertions++;
+                        read_length += length;
+                        _add(profile.insertion_lengths, length);
+                        break;
+                    case 'D':
+                        deletions++;
+                        ref_bases += length;
+                        _add(profile.deletion_lengths, length);
+                        break;
+                    default:
+                        break;
+                }
+                length = 0;
+            }
+            _add(profile.length_weights, read_length);
+        }
+        if (ref_bases > 0) {
+            profile.substitution_rate = substitutions / ref_bases;
+            profile.insertion_rate = insertions / ref_bases;
+            profile.deletion_rate = deletions / ref_bases;
+        }
+        profile.homopolymer_factor = 1;
+        return profile;
+    }
+
+private:
+    static void _add(std::vector<double>& weights, int value) {
+        if ((int) weights.size() <= value) {
+            weights.resize(value + 1, 0);
+        }
+        weights[value]++;
+    }
+};
+
+
+/**
+ * Simulates pairs of a read and its reference with an error_profile, and their true
+ * alignment as an =/X CIGAR (I: base only in the read, D: base only in the reference).
+ * As with Dataset, pair i only depends on (seed, i), so the output is the same at any
+ * number of threads.
+ */
+class read_simulator {
+protected:
+    error_profile profile;
+    uint64_t seed;
+    int num_threads;
+
+    // cumulative weights of the empirical distributions
+    std::vector<double> length_cdf, insertion_cdf, deletion_cdf;
+
+    // multiplier of the indel rates in a homopolymer of each length
+    std::vector<double> homopolymer_multiplier;
+
+    static std::vector<double> _cumulate(const std::vector<double>& weights) {
+        std::vector<double> cdf(weights.size());
+        double total = 0;
+        for (size_t i = 0; i < weights.size(); i++) {
+            cdf[i] = total += weights[i];
+        }
+        return cdf;
+    }
+
+    static int _sample(counter_rng& rng, const std::vector<double>& cdf) {
+        double target = rng.uniform() * cdf.back();
+        return (int) (std::upper_bound(cdf.begin(), cdf.end(), target) - cdf.begin());
+    }
+
+    static double _normal(counter_rng& rng) {
+        double u = 1 - rng.uniform();
+        return std::sqrt(-2 * std::log(u)) * std::cos(2 * M_PI * rng.uniform());
+    }
+
+    int _read_length(counter_rng& rng) {
+        int length;
+        if (!length_cdf.empty()) {
+            length = _sample(rng, length_cdf);
+        } else {
+            length = (int) std::lround(profile.length_mean + profile.length_sd * _normal(rng));
+        }
+        return std::clamp(length, std::max(1, profile.min_length), std::max(1, profile.max_length));
+    }
+
+    int _indel_length(counter_rng& rng, const std::vector<double>& cdf) {
+        if (!cdf.empty()) {
+            return std::max(1, _sample(rng, cdf));
+        }
+        int length = 1;
+        while (rng.uniform() < profile.indel_extend) {
+            length++;
+        }
+        return length;
+    }
+
+    char _random_base(counter_rng& rng) {
+        return alphabet[rng.uniform(0, ALPHABET_SIZE)];
+    }
+
+    /**
+     * Append reference bases until it has at least `length` bases.
+     */
+    void _extend_reference(counter_rng& rng, std::string& ref, size_t length) {
+        while (ref.length() < length) {
+            if (!ref.empty() && rng.uniform() < profile.repeat_rate) {
+                ref += ref.back();
+            } else {
+                ref += _random_base(rng);
+            }
+        }
+    }
+
+    /**
+     * Length of the homopolymer of the reference that contains position j, at most
+     * MAX_HOMOPOLYMER.
+     */
+    static int _homopolymer(const std::string& ref, size_t j) {
+        size_t begin = j, end = j + 1;
+        while (begin > 0 && ref[begin - 1] == ref[j] && end - begin < MAX_HOMOPOLYMER) {
+            begin--;
+        }
+        while (end < ref.length() && ref[end] == ref[j] && end - begin < MAX_HOMOPOLYMER) {
+            end++;
+        }
+        return (int) (end - begin);
+    }
+
+public:
+    /**
+     * @param _seed seed of the pairs; the same seed gives the same pairs.
+     * @param _num_threads number of threads simulating the pairs. Default: 0, i.e. one per
+     *                     hardware thread.
+     */
+    explicit read_simulator(const error_profile& _profile, uint64_t _seed = DATASET_DEFAULT_SEED, int _num_threads = 0) {
+        profile = _profile;
+        seed = _seed;
+        num_threads = _num_threads;
+        if (!profile.length_weights.empty()) {
+            length_cdf = _cumulate(profile.length_weights);
+        }
+        if (!profile.insertion_lengths.empty()) {
+            insertion_cdf = _cumulate(profile.insertion_lengths);
+        }
+        if (!profile.deletion_lengths.empty()) {
+            deletion_cdf = _cumulate(profile.deletion_lengths);
+        }
+        for (int h = 0; h <= MAX_HOMOPOLYMER; h++) {
+            homopolymer_multiplier.push_back(std::min(std::pow(profile.homopolymer_factor, std::max(0, h - 1)),
+                                                      profile.max_homopolymer_factor));
+        }
+    }
+
+    /**
+     * Simulate pair i.
+     * @param read the simulated read.
+     * @param ref the reference it was read from.
+     * @param CIGAR the true alignment of the read against the reference.
+     */
+    void simulate(uint64_t i, std::string& read, std::string& ref, std::string& CIGAR) {
+        counter_rng rng(seed, i);
+        int length = _read_length(rng);
+        read.clear();
+        ref.clear();
+        std::string operations;
+
+        // a long gap starts before read base long_gap_position
+        int long_gap_position = -1, long_gap_length = 0;
+        bool long_gap_deleted = false;
+        if (rng.uniform() < profile.long_gap_rate && length > 2) {
+            long_gap_position = (int) rng.uniform(1, length);
+            long_gap_length = (int) rng.uniform(profile.long_gap_min, std::max(profile.long_gap_min, profile.long_gap_max) + 1);
+            long_gap_deleted = rng.uniform() < 0.5;
+        }
+
+        size_t j = 0;
+        const size_t max_ref_length = std::max(1, profile.max_ref_length);
+        _extend_reference(rng, ref, length + length / 2 + 16);
+        while ((int) read.length() < length && j < max_ref_length) {
+            if ((int) read.length() == long_gap_position) {
+                long_gap_position = -1;
+                if (long_gap_deleted) {
+                    int gap = (int) std::min<size_t>(long_gap_length, max_ref_length - j);
+                    _extend_reference(rng, ref, j + gap + 1);
+                    operations.append(gap, 'D');
+                    j += gap;
+                } else {
+                    int gap = std::min(long_gap_length, length - (int) read.length());
+                    for (int g = 0; g < gap; g++) {
+                        read += _random_base(rng);
+                    }
+                    operations.append(gap, 'I');
+                }
+                continue;
+            }
+            _extend_reference(rng, ref, j + 1);
+            double position = 1 + profile.position_slope * read.length() / length;
+            int homopolymer = _homopolymer(ref, j);
+            double indel = position * homopolymer_multiplier[homopolymer];
+            double deletion = profile.deletion_rate * indel;
+            double insertion = deletion + profile.insertion_rate * indel;
+            double substitution = insertion + profile.substitution_rate * position;
+            double draw = rng.uniform();
+            if (draw < deletion) {
+                int gap = (int) std::min<size_t>(_indel_length(rng, deletion_cdf), max_ref_length - j);
+                _extend_reference(rng, ref, j + gap + 1);
+                operations.append(gap, 'D');
+                j += gap;
+            } else if (draw < insertion) {
+                int gap = std::min(_indel_length(rng, insertion_cdf), length - (int) read.length());
+                for (int g = 0; g < gap; g++) {
+                    read += homopolymer > 1 ? ref[j] : _random_base(rng);
+                }
+                operations.append(gap, 'I');
+            } else if (draw < substitution) {
+                read += alphabet[(strchr(alphabet, ref[j]) - alphabet + rng.uniform(1, ALPHABET_SIZE)) % ALPHABET_SIZE];
+                operations += 'X';
+                j++;
+            } else {
+                read += ref[j];
+                operations += '=';
+                j++;
+            }
+        }
+        // the alignment is global: the reference ends where the read does, and the read ends
+        // early if the reference reached max_ref_length
+        ref.resize(j);
+        CIGAR = compress_CIGAR(operations);
+    }
+
+    /**
+     * Simulate `num_pairs` pairs into a dataset file (">read" and "<ref" lines) and their true
+     * CIGARs, one per line, into `CIGAR_dir` unless it is null.
+     * @return false if a file could not be opened.
+     */
+    bool output(int num_pairs, const char* output_dir, const char* CIGAR_dir = nullptr) {
+        FILE* output_file = fopen(output_dir, "w");
+        FILE* CIGAR_file = CIGAR_dir == nullptr ? nullptr : fopen(CIGAR_dir, "w");
+        if (output_file == nullptr || (CIGAR_dir != nullptr && CIGAR_file == nullptr)) {
+            fprintf(stderr, "Unable to open output file: %s\n", output_file == nullptr ? output_dir : CIGAR_dir);
+            if (output_file != nullptr) {
+                fclose(output_file);
+            }
+            if (CIGAR_file != nullptr) {
+                fclose(CIGAR_file);
+            }
+            return false;
+        }
+        // as in Dataset::output(), the chunks of a round are simulated in parallel, then
+        // written in order
+        thread_pool pool(num_threads);
+        const int chunks_per_round = 4 * pool.size();
+        std::vector<std::string> pairs(chunks_per_round), CIGARs(chunks_per_round);
+        for (int round_begin = 0; round_begin < num_pairs; round_begin += chunks_per_round * DATASET_CHUNK_SIZE) {
+            int round_chunks = std::min<long>(chunks_per_round,
+                                              ((long) num_pairs - round_begin + DATASET_CHUNK_SIZE - 1) / DATASET_CHUNK_SIZE);
+            pool.parallel_for(round_chunks, 1, [&](int, int begin, int end) {
+                std::string read, ref, CIGAR;
+                for (int chunk = begin; chunk < end; chunk++) {
+                    int first = round_begin + chunk * DATASET_CHUNK_SIZE;
+                    int last = std::min(first + DATASET_CHUNK_SIZE, num_pairs);
+                    pairs[chunk].clear();
+                    CIGARs[chunk].clear();
+                    for (int i = first; i < last; i++) {
+                        simulate(i, read, ref, CIGAR);
+                        pairs[chunk] += '>';
+                        pairs[chunk] += read;
+                        pairs[chunk] += "\n<";
+                        pairs[chunk] += ref;
+                        pairs[chunk] += '\n';
+                        CIGARs[chunk] += CIGAR;
+                        CIGARs[chunk] += '\n';
+                    }
+                }
+            });
+            for (int chunk = 0; chunk < round_chunks; chunk++) {
+                fwrite(pairs[chunk].data(), 1, pairs[chunk].size(), output_file);
+                if (CIGAR_file != nullptr) {
+                    fwrite(CIGARs[chunk].data(), 1, CIGARs[chunk].size(), CIGAR_file);
+                }
+            }
+        }
+        bool success = fclose(output_file) == 0;
+        if (CIGAR_file != nullptr) {
+            success = fclose(CIGAR_file) == 0 && success;
+        }
+        return success;
+    }
+};
+
+
+#endif //GASMA_READ_SIMULATOR_H
@@ -10,40 +10,40 @@
 #include <x86intrin.h>
 #include "bit_convert.h"
 
-uint8_t BASE_SHIFT11[16] __aligned__ = { 0x0, 0x4, 0x8, 0xc, 0x2, 0x6, 0xa, 0xe,
+uint8_t BASE_SHIFT11[16] GASMA_ALIGNED = { 0x0, 0x4, 0x8, 0xc, 0x2, 0x6, 0xa, 0xe,
                                          0x1, 0x5, 0x9, 0xd, 0x3, 0x7, 0xb, 0xf };
 
-char MASKA_16[16] __aligned__ = { 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A',
+char MASKA_16[16] GASMA_ALIGNED = { 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A',
                                   'A', 'A', 'A', 'A', 'A', 'A', 'A' };
 
-char MASKC_16[16] __aligned__ = { 'C', 'C', 'C', 'C', 'C', 'C', 'C', 'C', 'C',
+char MASKC_16[16] GASMA_ALIGNED = { 'C', 'C', 'C', 'C', 'C', 'C', 'C', 'C', 'C',
                                   'C', 'C', 'C', 'C', 'C', 'C', 'C' };
 
-char MASKG_16[16] __aligned__ = { 'G', 'G', 'G', 'G', 'G', 'G', 'G', 'G', 'G',
+char MASKG_16[16] GASMA_ALIGNED = { 'G', 'G', 'G', 'G', 'G', 'G', 'G', 'G', 'G',
                                   'G', 'G', 'G', 'G', 'G', 'G', 'G' };
 
-char MASKT_16[16] __aligned__ = { 'T', 'T', 'T', 'T', 'T', 'T', 'T', 'T', 'T',
+char MASKT_16[16] GASMA_ALIGNED = { 'T', 'T', 'T', 'T', 'T', 'T', 'T', 'T', 'T',
                                   'T', 'T', 'T', 'T', 'T', 'T', 'T' };
 
-uint8_t BIT_A_16[16] __aligned__ = { 0x00, 0x00, 0x00, 0x00, //A
+uint8_t BIT_A_16[16] GASMA_ALIGNED = { 0x00, 0x00, 0x00, 0x00, //A
                                      0x00, 0x00, 0x00, 0x00, //A
                                      0x00, 0x00, 0x00, 0x00, //A
                                      0x00, 0x00, 0x00, 0x00 //A
 };
 
-uint8_t BIT_C_16[16] __aligned__ = { 0x55, 0x55, 0x55, 0x55, //C
+uint8_t BIT_C_16[16] GASMA_ALIGNED = { 0x55, 0x55, 0x55, 0x55, //C
                                      0x55, 0x55, 0x55, 0x55, //C
                                      0x55, 0x55, 0x55, 0x55, //C
                                      0x55, 0x55, 0x55, 0x55 //C
 };
 
-uint8_t BIT_G_16[16] __aligned__ = { 0xaa, 0xaa, 0xaa, 0xaa, //G
+uint8_t BIT_G_16[16] GASMA_ALIGNED = { 0xaa, 0xaa, 0xaa, 0xaa, //G
                                      0xaa, 0xaa, 0xaa, 0xaa, //G
                                      0xaa, 0xaa, 0xaa, 0xaa, //G
                                      0xaa, 0xaa, 0xaa, 0xaa //G
 };
 
-uint8_t BIT_T_16[16] __aligned__ = { 0xff, 0xff, 0xff, 0xff, //T
+uint8_t BIT_T_16[16] GASMA_ALIGNED = { 0xff, 0xff, 0xff, 0xff, //T
                                      0xff, 0xff, 0xff, 0xff, //T
                                      0xff, 0xff, 0xff, 0xff, //T
                                      0xff, 0xff, 0xff, 0xff //T
@@ -194,16 +194,16 @@ void sse3_convert2bit11(char *str, int length, uint8_t *bits) {
     }
 }
 
-uint8_t BIT_00[16] __aligned__ = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+uint8_t BIT_00[16] GASMA_ALIGNED = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
                                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
 
-uint8_t BIT_FF[16] __aligned__ = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+uint8_t BIT_FF[16] GASMA_ALIGNED = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
                                    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
 
-uint8_t BASE_SHIFT1[16] __aligned__ = { 0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13,
+uint8_t BASE_SHIFT1[16] GASMA_ALIGNED = { 0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13,
                                         3, 11, 7, 15 };
 
-uint8_t BASE_SHIFT2[16] __aligned__ = { 0, 1, 8, 9, 4, 5, 12, 13, 2, 3, 10, 11,
+uint8_t BASE_SHIFT2[16] GASMA_ALIGNED = { 0, 1, 8, 9, 4, 5, 12, 13, 2, 3, 10, 11,
                                         6, 7, 14, 15 };
 
 //Have to consider Intel's endians
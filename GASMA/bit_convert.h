@@ -10,8 +10,9 @@
 
 #include <cstdint>
 
-#ifndef __aligned__
-#define __aligned__ __attribute__((aligned(16)))
+// not named __aligned__, which is also the name of the attribute
+#ifndef GASMA_ALIGNED
+#define GASMA_ALIGNED __attribute__((aligned(16)))
 #endif
 
 void c_convert2bit(char *str, int length, uint8_t *bits);
@@ -0,0 +1,286 @@
+#include <new>
+
+#include "gasma.h"
+#include "../batch_aligner.h"
+
+struct gasma_aligner {
+    gasma_options options;
+
+    // matrix for gasma_align() and gasma_score()
+    hurdle_matrix<int_128bit>* matrix;
+
+    // workers for gasma_align_batch()
+    batch_aligner<int_128bit>* batch;
+};
+
+namespace {
+
+/**
+ * Convert a CIGAR string into binary operations.
+ * @return number of operations, or -1 if they do not fit into the buffer.
+ */
+int32_t encode_CIGAR(const std::string& CIGAR, uint32_t* cigar, int32_t capacity) {
+    int32_t num_ops = 0;
+    uint32_t length = 0;
+    for (char c : CIGAR) {
+        if (isdigit(c)) {
+            length = length * 10 + (c - '0');
+            continue;
+        }
+        if (num_ops >= capacity) {
+            return -1;
+        }
+        uint32_t op;
+        switch (c) {
+            case 'I': op = GASMA_CIGAR_INS; break;
+            case 'D': op = GASMA_CIGAR_DEL; break;
+            case '=': op = GASMA_CIGAR_EQUAL; break;
+            case 'X': op = GASMA_CIGAR_DIFF; break;
+            default: op = GASMA_CIGAR_MATCH; break;
+        }
+        cigar[num_ops++] = length << 4 | op;
+        length = 0;
+    }
+    return num_ops;
+}
+
+/**
+ * Clear the result and check the arguments of one pair.
+ */
+int32_t check_pair(const void* read, int32_t read_len, const void* ref, int32_t ref_len, gasma_result* result) {
+    result->cost = 0;
+    result->termination = GASMA_COMPLETED;
+    result->num_cigar_ops = 0;
+    result->nm = 0;
+    if (read == nullptr || ref == nullptr || read_len < 0 || ref_len < 0) {
+        return result->status = GASMA_ERROR_INVALID_ARGUMENT;
+    }
+    if (read_len > GASMA_MAX_LENGTH || ref_len > GASMA_MAX_LENGTH) {
+        return result->status = GASMA_ERROR_TOO_LONG;
+    }
+    return result->status = GASMA_OK;
+}
+
+/**
+ * Align the pair that `matrix` was reset with, and write the result.
+ */
+int32_t run_pair(hurdle_matrix<int_128bit>& matrix, const gasma_options& options,
+                 uint32_t* cigar, int32_t cigar_capacity, gasma_result* result) {
+    matrix.run();
+    if (options.polish) {
+        matrix.polish();
+    }
+    result->cost = matrix.get_cost();
+    result->termination = matrix.get_termination();
+    result->status = GASMA_OK;
+    if (cigar == nullptr) {
+        return result->status;
+    }
+
+    int32_t num_ops;
+    if (options.extended_cigar) {
+        matrix.resolve_mismatches();
+        result->nm = matrix.get_NM();
+        num_ops = encode_CIGAR(matrix.get_extended_CIGAR(), cigar, cigar_capacity);
+    } else {
+        num_ops = encode_CIGAR(matrix.get_CIGAR(), cigar, cigar_capacity);
+    }
+    if (num_ops < 0) {
+        return result->status = GASMA_ERROR_BUFFER_TOO_SMALL;
+    }
+    result->num_cigar_ops = num_ops;
+    return result->status;
+}
+
+/**
+ * Align one pair of character strings with `matrix` and write the result.
+ */
+int32_t align_pair(hurdle_matrix<int_128bit>& matrix, const gasma_options& options,
+                   const char* read, int32_t read_len, const char* ref, int32_t ref_len,
+                   uint32_t* cigar, int32_t cigar_capacity, gasma_result* result) {
+    if (check_pair(read, read_len, ref, ref_len, result) != GASMA_OK) {
+        return result->status;
+    }
+    matrix.reset(read, read_len, ref, ref_len, options.band);
+    return run_pair(matrix, options, cigar, cigar_capacity, result);
+}
+
+/**
+ * Align pair i of two sequence arrays with `matrix` and write the result.
+ */
+int32_t align_array_pair(hurdle_matrix<int_128bit>& matrix, const gasma_options& options,
+                         const gasma_sequences& reads, const gasma_sequences& refs, int32_t i,
+                         uint32_t* cigar, int32_t cigar_capacity, gasma_result* result) {
+    const uint8_t* read = reads.data + i * reads.stride;
+    const uint8_t* ref = refs.data + i * refs.stride;
+    int32_t read_len = reads.lengths[i];
+    int32_t ref_len = refs.lengths[i];
+    if (check_pair(read, read_len, ref, ref_len, result) != GASMA_OK) {
+        return result->status;
+    }
+    if (reads.encoding == GASMA_2BIT && refs.encoding == GASMA_2BIT) {
+        matrix.reset_packed(read, read_len, ref, ref_len, options.band);
+    } else if (reads.encoding == GASMA_ASCII && refs.encoding == GASMA_ASCII) {
+        matrix.reset(reinterpret_cast<const char*>(read), read_len, reinterpret_cast<const char*>(ref), ref_len, options.band);
+    } else {
+        return result->status = GASMA_ERROR_INVALID_ARGUMENT;
+    }
+    return run_pair(matrix, options, cigar, cigar_capacity, result);
+}
+
+/**
+ * Call align(matrix, i, cigar, result) for each pair on the workers of the aligner, where
+ * `cigar` and `result` are the output slots of pair i. No exception leaves this function.
+ */
+template <typename F>
+int32_t for_each_pair(gasma_aligner* aligner, int32_t num_pairs, uint32_t* cigars, int32_t cigar_stride,
+                      gasma_result* results, const F& align) {
+    try {
+        aligner->batch->for_each(num_pairs, [&](hurdle_matrix<int_128bit>& matrix, int i) {
+            // the worker threads must not see an exception
+            try {
+                uint32_t* cigar = cigars == nullptr ? nullptr : cigars + (size_t) i * cigar_stride;
+                align(matrix, i, cigar, &results[i]);
+            } catch (const std::bad_alloc&) {
+                results[i].status = GASMA_ERROR_OUT_OF_MEMORY;
+            } catch (...) {
+                results[i].status = GASMA_ERROR_INTERNAL;
+            }
+        });
+    } catch (const std::bad_alloc&) {
+        return GASMA_ERROR_OUT_OF_MEMORY;
+    } catch (...) {
+        return GASMA_ERROR_INTERNAL;
+    }
+    return GASMA_OK;
+}
+
+}
+
+extern "C" {
+
+int32_t gasma_version(void) {
+    return GASMA_VERSION;
+}
+
+void gasma_default_options(gasma_options* options) {
+    if (options == nullptr) {
+        return;
+    }
+    options->band = 3;
+    options->alignment_type = GASMA_GLOBAL;
+    options->mismatch = 1;
+    options->gap_open = 1;
+    options->gap_extend = 1;
+    options->num_threads = 1;
+    options->polish = 0;
+    options->extended_cigar = 0;
+}
+
+gasma_aligner* gasma_create(const gasma_options* options) {
+    gasma_options settings;
+    gasma_default_options(&settings);
+    if (options != nullptr) {
+        settings = *options;
+    }
+    if (settings.band < 0 || settings.band > MAX_K || settings.num_threads < 0 ||
+        (settings.alignment_type != GASMA_GLOBAL && settings.alignment_type != GASMA_SEMI_GLOBAL) ||
+        settings.mismatch < 0 || settings.gap_open < 0 || settings.gap_extend < 0) {
+        return nullptr;
+    }
+
+    auto alignment_type = settings.alignment_type == GASMA_GLOBAL ? GLOBAL : SEMI_GLOBAL;
+    gasma_aligner* aligner = nullptr;
+    try {
+        aligner = new gasma_aligner{settings, nullptr, nullptr};
+        aligner->matrix = new hurdle_matrix<int_128bit>(alignment_type, settings.mismatch,
+                                                        settings.gap_open, settings.gap_extend);
+        aligner->batch = new batch_aligner<int_128bit>(settings.num_threads, settings.band, alignment_type,
+                                                       settings.mismatch, settings.gap_open, settings.gap_extend);
+    } catch (...) {
+        gasma_destroy(aligner);
+        return nullptr;
+    }
+    return aligner;
+}
+
+void gasma_destroy(gasma_aligner* aligner) {
+    if (aligner == nullptr) {
+        return;
+    }
+    delete aligner->matrix;
+    delete aligner->batch;
+    delete aligner;
+}
+
+int32_t gasma_align(gasma_aligner* aligner,
+                    const char* read, int32_t read_len,
+                    const char* ref, int32_t ref_len,
+                    uint32_t* cigar, int32_t cigar_capacity,
+                    gasma_result* result) {
+    if (aligner == nullptr || result == nullptr) {
+        return GASMA_ERROR_INVALID_ARGUMENT;
+    }
+    if (cigar != nullptr && cigar_capacity <= 0) {
+        return result->status = GASMA_ERROR_INVALID_ARGUMENT;
+    }
+    try {
+        return align_pair(*aligner->matrix, aligner->options, read, read_len, ref, ref_len,
+                          cigar, cigar == nullptr ? 0 : cigar_capacity, result);
+    } catch (const std::bad_alloc&) {
+        return result->status = GASMA_ERROR_OUT_OF_MEMORY;
+    } catch (...) {
+        return result->status = GASMA_ERROR_INTERNAL;
+    }
+}
+
+int32_t gasma_score(gasma_aligner* aligner,
+                    const char* read, int32_t read_len,
+                    const char* ref, int32_t ref_len,
+                    int32_t* cost) {
+    if (aligner == nullptr || cost == nullptr) {
+        return GASMA_ERROR_INVALID_ARGUMENT;
+    }
+    // the path is built by the run itself, so this is gasma_align() without the CIGAR encoding
+    gasma_result result;
+    int32_t status = gasma_align(aligner, read, read_len, ref, ref_len, nullptr, 0, &result);
+    *cost = result.cost;
+    return status;
+}
+
+int32_t gasma_align_batch(gasma_aligner* aligner,
+                          const gasma_pair* pairs, int32_t num_pairs,
+                          uint32_t* cigars, int32_t cigar_stride,
+                          gasma_result* results) {
+    if (aligner == nullptr || results == nullptr || num_pairs < 0 || (num_pairs > 0 && pairs == nullptr) ||
+        (cigars != nullptr && cigar_stride <= 0)) {
+        return GASMA_ERROR_INVALID_ARGUMENT;
+    }
+    const gasma_options& options = aligner->options;
+    return for_each_pair(aligner, num_pairs, cigars, cigar_stride, results,
+                         [&](hurdle_matrix<int_128bit>& matrix, int i, uint32_t* cigar, gasma_result* result) {
+        align_pair(matrix, options, pairs[i].read, pairs[i].read_len, pairs[i].ref, pairs[i].ref_len,
+                   cigar, cigar == nullptr ? 0 : cigar_stride, result);
+    });
+}
+
+int32_t gasma_align_arrays(gasma_aligner* aligner,
+                           const gasma_sequences* reads, const gasma_sequences* refs, int32_t num_pairs,
+                           uint32_t* cigars, int32_t cigar_stride,
+                           gasma_result* results) {
+    if (reads == nullptr || refs == nullptr ||
+        (num_pairs > 0 && (reads->data == nullptr || reads->lengths == nullptr ||
+                           refs->data == nullptr || refs->lengths == nullptr))) {
+        return GASMA_ERROR_INVALID_ARGUMENT;
+    }
+    if (aligner == nullptr || results == nullptr || num_pairs < 0 || (cigars != nullptr && cigar_stride <= 0)) {
+        return GASMA_ERROR_INVALID_ARGUMENT;
+    }
+    const gasma_options& options = aligner->options;
+    return for_each_pair(aligner, num_pairs, cigars, cigar_stride, results,
+                         [&](hurdle_matrix<int_128bit>& matrix, int i, uint32_t* cigar, gasma_result* result) {
+        align_array_pair(matrix, options, *reads, *refs, i, cigar, cigar == nullptr ? 0 : cigar_stride, result);
+    });
+}
+
+}
@@ -0,0 +1,192 @@
+/**
+ * C interface of the greedy aligner, built as libgasma.so.
+ * Aligners are opaque handles. No function throws or allocates memory per call: the caller
+ * provides the output buffers, and every function returns a gasma_status.
+ * A handle must not be used by two threads at the same time. gasma_align_batch() uses the
+ * worker threads of the handle itself.
+ */
+
+#ifndef GASMA_CAPI_GASMA_H
+#define GASMA_CAPI_GASMA_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define GASMA_API __attribute__((visibility("default")))
+#else
+#define GASMA_API
+#endif
+
+#define GASMA_VERSION 1
+
+/** Longest read and reference that can be aligned. */
+#define GASMA_MAX_LENGTH 128
+
+/** Largest number of CIGAR operations of one alignment. */
+#define GASMA_MAX_CIGAR_OPS (2 * GASMA_MAX_LENGTH)
+
+/**
+ * Binary CIGAR operations, as in BAM: each operation is stored as (length << 4) | op.
+ */
+#define GASMA_CIGAR_MATCH 0      /* M */
+#define GASMA_CIGAR_INS 1        /* I, consumes the read */
+#define GASMA_CIGAR_DEL 2        /* D, consumes the reference */
+#define GASMA_CIGAR_EQUAL 7      /* = */
+#define GASMA_CIGAR_DIFF 8       /* X */
+
+typedef enum gasma_status {
+    GASMA_OK = 0,
+    GASMA_ERROR_INVALID_ARGUMENT = -1,  /* null handle or buffer, negative length */
+    GASMA_ERROR_TOO_LONG = -2,          /* read or reference longer than GASMA_MAX_LENGTH */
+    GASMA_ERROR_BUFFER_TOO_SMALL = -3,  /* the CIGAR does not fit in the buffer */
+    GASMA_ERROR_OUT_OF_MEMORY = -4,
+    GASMA_ERROR_INTERNAL = -5
+} gasma_status;
+
+typedef enum gasma_alignment_type {
+    GASMA_GLOBAL = 0,
+    GASMA_SEMI_GLOBAL = 1
+} gasma_alignment_type;
+
+typedef enum gasma_termination {
+    GASMA_COMPLETED = 0,
+    GASMA_COST_EXCEEDED = 1,
+    GASMA_STEPS_EXCEEDED = 2
+} gasma_termination;
+
+/**
+ * Settings of an aligner. Fill with gasma_default_options() before changing single fields.
+ */
+typedef struct gasma_options {
+    int32_t band;               /* band width k. Default: 3 */
+    int32_t alignment_type;     /* gasma_alignment_type. Default: GASMA_GLOBAL */
+    int32_t mismatch;           /* mismatch penalty. Default: 1 */
+    int32_t gap_open;           /* gap opening penalty. Default: 1 */
+    int32_t gap_extend;         /* gap extension penalty. Default: 1 */
+    int32_t num_threads;        /* workers of gasma_align_batch(), 0: one per hardware thread. Default: 1 */
+    int32_t polish;             /* non-zero: re-align around the leaps with an exact DP (GLOBAL only, allocates). Default: 0 */
+    int32_t extended_cigar;     /* non-zero: =/X instead of M, and compute NM. Default: 0 */
+} gasma_options;
+
+/**
+ * Result of one alignment.
+ */
+typedef struct gasma_result {
+    int32_t status;             /* gasma_status of this alignment */
+    int32_t cost;               /* penalty of the alignment */
+    int32_t termination;        /* gasma_termination */
+    int32_t num_cigar_ops;      /* number of binary CIGAR operations written */
+    int32_t nm;                 /* SAM NM tag, only set if extended_cigar is enabled */
+} gasma_result;
+
+/**
+ * A pair of strings for gasma_align_batch(). The strings do not need to be null-terminated.
+ */
+typedef struct gasma_pair {
+    const char* read;
+    int32_t read_len;
+    const char* ref;
+    int32_t ref_len;
+} gasma_pair;
+
+/**
+ * Encoding of the sequences of gasma_align_arrays().
+ */
+typedef enum gasma_encoding {
+    GASMA_ASCII = 0,            /* one character per byte */
+    GASMA_2BIT = 1              /* 4 bases per byte, first base in the lowest two bits, A = 0, C = 1, G = 2, T = 3 */
+} gasma_encoding;
+
+/**
+ * Sequences stored at a fixed distance from each other, e.g. the rows of a 2-d byte array.
+ * Sequence i starts at data + i * stride and has lengths[i] bases.
+ */
+typedef struct gasma_sequences {
+    const uint8_t* data;
+    int64_t stride;             /* bytes between the starts of two sequences */
+    const int32_t* lengths;
+    int32_t encoding;           /* gasma_encoding */
+} gasma_sequences;
+
+typedef struct gasma_aligner gasma_aligner;
+
+/**
+ * Return GASMA_VERSION of the library, to check it against the header.
+ */
+GASMA_API int32_t gasma_version(void);
+
+/**
+ * Fill the options with the default settings.
+ */
+GASMA_API void gasma_default_options(gasma_options* options);
+
+/**
+ * Create an aligner. Returns NULL if the options are invalid or the memory runs out.
+ * @param options the settings, or NULL for the default settings.
+ */
+GASMA_API gasma_aligner* gasma_create(const gasma_options* options);
+
+/**
+ * Destroy an aligner created by gasma_create(). Does nothing on NULL.
+ */
+GASMA_API void gasma_destroy(gasma_aligner* aligner);
+
+/**
+ * Align one pair.
+ * @param cigar buffer for the binary CIGAR, or NULL to skip it. GASMA_MAX_CIGAR_OPS entries always suffice.
+ * @param cigar_capacity number of entries of the buffer, positive if cigar is not NULL.
+ * @param result the result of the alignment.
+ * @return the status, also stored in result->status.
+ */
+GASMA_API int32_t gasma_align(gasma_aligner* aligner,
+                              const char* read, int32_t read_len,
+                              const char* ref, int32_t ref_len,
+                              uint32_t* cigar, int32_t cigar_capacity,
+                              gasma_result* result);
+
+/**
+ * Compute only the cost of the alignment of one pair. This is a convenience wrapper of
+ * gasma_align() without a CIGAR buffer, not a faster entry point: the greedy algorithm builds
+ * its path while it runs, so the work is the same, only the CIGAR encoding is skipped.
+ * @param cost the penalty of the alignment.
+ * @return the status.
+ */
+GASMA_API int32_t gasma_score(gasma_aligner* aligner,
+                              const char* read, int32_t read_len,
+                              const char* ref, int32_t ref_len,
+                              int32_t* cost);
+
+/**
+ * Align many pairs with the worker threads of the aligner.
+ * @param pairs the pairs to align.
+ * @param num_pairs number of pairs.
+ * @param cigars buffer for the binary CIGARs, or NULL to skip them. The CIGAR of pair i is
+ *               written at cigars + i * cigar_stride.
+ * @param cigar_stride number of entries reserved for each pair.
+ * @param results one result per pair, with the status of each pair.
+ * @return GASMA_OK if the arguments are valid, even if single pairs failed.
+ */
+GASMA_API int32_t gasma_align_batch(gasma_aligner* aligner,
+                                    const gasma_pair* pairs, int32_t num_pairs,
+                                    uint32_t* cigars, int32_t cigar_stride,
+                                    gasma_result* results);
+
+/**
+ * Align reads[i] with refs[i] for i = 0, ..., num_pairs - 1 with the worker threads of the
+ * aligner, reading the sequences in place. Both arrays must have the same encoding.
+ * The other arguments are as in gasma_align_batch().
+ */
+GASMA_API int32_t gasma_align_arrays(gasma_aligner* aligner,
+                                     const gasma_sequences* reads, const gasma_sequences* refs, int32_t num_pairs,
+                                     uint32_t* cigars, int32_t cigar_stride,
+                                     gasma_result* results);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //GASMA_CAPI_GASMA_H
@@ -6,11 +6,23 @@
 #define GASMA_HURDLE_MATRIX_H
 
 #define MAX_K 50  // The maximum probable value for k
+#ifndef SIGHT
+#define SIGHT 3  // LOOKAHEAD: how many columns ahead a highway must start to be considered
+#endif
+#ifndef SHD_WIDEN_RATIO
+#define SHD_WIDEN_RATIO 4  // widen the estimated band if more than 1/SHD_WIDEN_RATIO of the columns have no match
+#endif
+#ifndef POLISH_WINDOW
+#define POLISH_WINDOW 8  // polish(): number of operations on each side of a leap to re-align
+#endif
 
 #include "utils.h"
+#include "banded_dp.h"
 #include <cstdlib>
+#include <algorithm>
 #include <limits>
 #include <math.h>
+#include <vector>
 
 /**
  * The main class for the greedy string matching algorithm.
@@ -116,6 +128,11 @@ private:
                 info[lane + MAX_K].num_hurdles = MAX_LENGTH;
                 info[lane + MAX_K].destination = _calculate_destination(m_, n_, lane);
             }
+            // the destination lane is used when finishing even if it is outside of the band
+            int destination_lane = n_ - m_;
+            if (abs(destination_lane) <= MAX_K) {
+                info[destination_lane + MAX_K].destination = _calculate_destination(m_, n_, destination_lane);
+            }
         }
 
         ~highways(){
@@ -124,6 +141,34 @@ private:
     };
     highways* highway_list;
 
+    /**
+     * Partial path kept in the beam search.
+     */
+    class beam_path {
+    public:
+        // current position
+        int lane;
+        int column;
+
+        // cost to reach the current position
+        int cost;
+
+        // cost of the complete alignment if the path leaps to the destination lane now
+        int finished_cost;
+
+        // lowest and highest lane visited by the path
+        int lowest_lane, highest_lane;
+
+        // whether the path took the greedy choice at every step
+        bool is_greedy;
+
+        // whether the path has reached the destination
+        bool is_finished;
+
+        // CIGAR string of the path so far
+        std::string CIGAR;
+    };
+
 
 protected:
     // maximum difference allowed
@@ -133,17 +178,17 @@ protected:
     int lower_bound, upper_bound;
 
     // two strings for comparison
-    char A[MAX_LENGTH] __aligned;
-    char B[MAX_LENGTH] __aligned;
+    char A[MAX_LENGTH] GASMA_ALIGNED;
+    char B[MAX_LENGTH] GASMA_ALIGNED;
 
 #ifdef DISPLAY
     // string storing the original two strings
-    char A_orig[MAX_LENGTH] __aligned;
-    char B_orig[MAX_LENGTH] __aligned;
+    char A_orig[MAX_LENGTH] GASMA_ALIGNED;
+    char B_orig[MAX_LENGTH] GASMA_ALIGNED;
 
     // strings storing the matched strings
-    char A_match[MAX_LENGTH * 2] __aligned;
-    char B_match[MAX_LENGTH * 2] __aligned;
+    char A_match[MAX_LENGTH * 2] GASMA_ALIGNED;
+    char B_match[MAX_LENGTH * 2] GASMA_ALIGNED;
     int A_index, B_index, A_match_index, B_match_index;
 #endif
 
@@ -168,10 +213,18 @@ protected:
     // CIGAR string used in mapper
     std::string CIGAR;
 
+    // CIGAR string with =/X instead of M, and the SAM NM and MD tags, set by resolve_mismatches()
+    std::string extended_CIGAR;
+    std::string MD;
+    int NM;
+
     // current position
     int current_lane;
     int current_column;
 
+    // lowest and highest lane visited by the path
+    int lowest_lane, highest_lane;
+
     // total cost
     int cost;
 
@@ -190,9 +243,16 @@ protected:
     // boolean value indicating whether it is the first step
     bool is_first_step;
 
+    // number of steps performed in the last run and the reason it stopped
+    int num_steps;
+    termination_t termination;
+
     // significance calculation
     double match_sig, mismatch_sig, indel_sig;
 
+    // exact DP used to polish the path around leaps
+    banded_dp polisher;
+
 #ifdef DISPLAY
     /**
      * Update the matching strings given the lanes we are leaping to and the distance we
@@ -258,21 +318,23 @@ protected:
      * B_bit0_t and B_bit1_t.
      */
     void _convert_read() {
-        // array of int8 objects to store the converted bits
-        uint8_t A_bit0_t[MAX_LENGTH / 8] __aligned;
-        uint8_t A_bit1_t[MAX_LENGTH / 8] __aligned;
-        uint8_t B_bit0_t[MAX_LENGTH / 8] __aligned;
-        uint8_t B_bit1_t[MAX_LENGTH / 8] __aligned;
+        // array of int8 objects to store the converted bits, as wide as T, which is read from them,
+        // and as MAX_LENGTH, which is written to them; bits beyond MAX_LENGTH stay zero
+        constexpr int num_bytes = std::max(T::width, MAX_LENGTH) / 8;
+        uint8_t A_bit0_t[num_bytes] GASMA_ALIGNED = {};
+        uint8_t A_bit1_t[num_bytes] GASMA_ALIGNED = {};
+        uint8_t B_bit0_t[num_bytes] GASMA_ALIGNED = {};
+        uint8_t B_bit1_t[num_bytes] GASMA_ALIGNED = {};
 
         // convert string A and B into bits and store in the int8 array
         sse3_convert2bit1(A, A_bit0_t, A_bit1_t);
         sse3_convert2bit1(B, B_bit0_t, B_bit1_t);
 
-        // convert the int8 array into 128-bit integer
-        A_bit0_mask = new T(A_bit0_t);
-        A_bit1_mask = new T(A_bit1_t);
-        B_bit0_mask = new T(B_bit0_t);
-        B_bit1_mask = new T(B_bit1_t);
+        // convert the int8 array into T, reusing the masks allocated by the constructor
+        *A_bit0_mask = T(A_bit0_t);
+        *A_bit1_mask = T(A_bit1_t);
+        *B_bit0_mask = T(B_bit0_t);
+        *B_bit1_mask = T(B_bit1_t);
     }
 
 
@@ -325,10 +387,14 @@ protected:
         for (int lane = lower_bound; lane <= upper_bound; lane++) {
             // get the best-looking highway
             int current_cost = - (*highway_list)[lane].switch_cost - (*highway_list)[lane].hurdle_cost;
+#ifdef LOOKAHEAD
+            heuristic = _sight_heuristic(lane);
+#else
             double significance = match_sig * (*highway_list)[lane].length +
                                   mismatch_sig * (*highway_list)[lane].num_hurdles +
                                   indel_sig * (*highway_list)[lane].num_switches;
             heuristic = significance;
+#endif
             leap_heuristic = - (*highway_list)[lane].switch_cost;
 
             if (reaching_destination) {
@@ -361,11 +427,97 @@ protected:
         return true;
     }
 
+#ifdef LOOKAHEAD
+    /**
+     * Score the closest highway of a lane by looking at most SIGHT columns ahead: the
+     * length of the highway minus the cost to reach it, and, in the second half of the
+     * alignment, minus how much further it moves us from the destination lane. Highways
+     * starting further than SIGHT columns away are only chosen if no highway is in
+     * sight, and then the closest one wins. Adopted from `GASMAProjection` in
+     * pymatch/algorithms/gasma.py.
+     * @param lane the lane of the highway.
+     * @return the score of the highway.
+     */
+    double _sight_heuristic(int lane) {
+        int start_col = current_column + switch_forward_column(current_lane, lane);
+        int columns_to_cross = (*highway_list)[lane].starting_point - start_col;
+        if (columns_to_cross > SIGHT) {
+            return - 4.0 * MAX_LENGTH - (*highway_list)[lane].starting_point;
+        }
+        int drift = 0;
+        if (2 * current_column > (*highway_list)[current_lane].destination) {
+            drift = switch_lane_penalty(lane, destination_lane, o, e) -
+                    switch_lane_penalty(current_lane, destination_lane, o, e);
+        }
+        return (*highway_list)[lane].length - (*highway_list)[lane].switch_cost -
+               (*highway_list)[lane].hurdle_cost - drift;
+    }
+
+    /**
+     * Look for a short highway on the lanes between the current lane and the lane of the
+     * best highway (and one lane beyond each side) that starts before the best highway.
+     * Close short highways are scored by their length, far ones only by their distance.
+     * Adopted from `findBestShortHighwayNearby` in pymatch/algorithms/gasma.py.
+     * @return the lane of the best short highway, or that of the best highway if none.
+     */
+    int _choose_short_highway() {
+        int target_lane = highway_list->best_highway_lane;
+        int max_column = (*highway_list)[target_lane].starting_point;
+        int lowest = std::min(current_lane, target_lane);
+        int highest = std::max(current_lane, target_lane);
+
+        double best_score = - std::numeric_limits<double>::infinity();
+        int best_lane = target_lane;
+        for (int lane = std::max(lowest - 1, lower_bound); lane <= std::min(highest + 1, upper_bound); lane++) {
+            if (lane == target_lane || (*highway_list)[lane].length <= 0 ||
+                (*highway_list)[lane].starting_point >= max_column - switch_forward_column(lane, target_lane)) {
+                continue;
+            }
+            int start_col = current_column + switch_forward_column(current_lane, lane);
+            double distance = (*highway_list)[lane].starting_point - start_col + 0.5 * (*highway_list)[lane].switch_cost;
+            double score = - distance - 2 * (lane < lowest || lane > highest);
+            if (distance <= 2) {
+                score += (*highway_list)[lane].length;
+            }
+            if (score > best_score || (score == best_score &&
+                    (*highway_list)[lane].switch_cost < (*highway_list)[best_lane].switch_cost)) {
+                best_score = score;
+                best_lane = lane;
+            }
+        }
+        return best_lane;
+    }
+
+    /**
+     * Decide where to leap from the current lane to best_lane: right away and cross the
+     * hurdles on best_lane, or walk on the current lane and leap just before the highway
+     * on best_lane. Pick the one with fewer hurdles. Adopted from `decideWhereToLeap` in
+     * pymatch/algorithms/gasma.py.
+     * The first leap of a non-GLOBAL alignment is free only from the start of the read, so
+     * it never walks first.
+     * @param best_lane the lane we are leaping to.
+     * @return the column on the current lane where we leap.
+     */
+    int _decide_where_to_leap(int best_lane) {
+        if (best_lane == current_lane || (is_first_step && alignment_type != GLOBAL)) {
+            return current_column;
+        }
+        int start_col = current_column + switch_forward_column(current_lane, best_lane);
+        int late_column = (*highway_list)[best_lane].starting_point - switch_forward_column(current_lane, best_lane);
+        int early_hurdles = lanes_orig[best_lane + MAX_K].pop_count_between(start_col, (*highway_list)[best_lane].starting_point);
+        int late_hurdles = lanes_orig[current_lane + MAX_K].pop_count_between(current_column, late_column);
+        return late_hurdles < early_hurdles ? late_column : current_column;
+    }
+#endif
+
     /**
      * Choose the best highway according to the updated highway list.
      * @return The lane number where the best highway is.
      */
     int _choose_best_highway() {
+#ifdef LOOKAHEAD
+        return _choose_short_highway();
+#else
         // information about the highway on the best lane
         int best_lane = highway_list->best_highway_lane;
         int starting_point = (*highway_list)[best_lane].starting_point;
@@ -398,6 +550,7 @@ protected:
             }
         }
         return best_intermediate_lane;
+#endif
     }
 
     /**
@@ -409,6 +562,22 @@ protected:
             return true;
         }
         int best_lane = _choose_best_highway();
+#ifdef LOOKAHEAD
+        int leap_column = _decide_where_to_leap(best_lane);
+        if (leap_column > current_column) {
+            // walk on the current lane first, then leap right onto the highway
+            int walked = leap_column - current_column;
+            cost += x * lanes_orig[current_lane + MAX_K].pop_count_between(current_column, leap_column);
+            (*highway_list)[best_lane].hurdle_cost = x * lanes_orig[best_lane + MAX_K].pop_count_between(
+                    (*highway_list)[best_lane].starting_point,
+                    (*highway_list)[best_lane].starting_point + (*highway_list)[best_lane].length);
+#ifdef DISPLAY
+            _update_match(current_lane, current_lane, walked);
+#endif
+            _update_CIGAR(current_lane, current_lane, walked, 0);
+            current_column = leap_column;
+        }
+#endif
         cost += (*highway_list)[best_lane].switch_cost + (*highway_list)[best_lane].hurdle_cost;
 
         // update matched strings
@@ -422,6 +591,8 @@ protected:
 
         // Update position
         current_lane = best_lane;
+        lowest_lane = std::min(lowest_lane, current_lane);
+        highest_lane = std::max(highest_lane, current_lane);
         current_column = (*highway_list)[best_lane].starting_point + (*highway_list)[best_lane].length;
 #ifdef DEBUG
         printf("current position: %d, %d\n", current_lane, current_column);
@@ -433,24 +604,305 @@ protected:
         return false;
     }
 
+    /**
+     * Check if we reach the final destination. If not, leap to the destination lane and
+     * walk to the destination column, adding the cost and CIGAR of this last segment.
+     */
+    void _finish() {
+        int destination_column = (*highway_list)[destination_lane].destination;
+        if (current_lane != destination_lane || current_column < destination_column) {
+            int switch_cost = 0;
+            if (alignment_type == GLOBAL) {
+                switch_cost = switch_lane_penalty(current_lane, destination_lane, o, e);
+            }
+            int start_column = current_column + switch_forward_column(current_lane, destination_lane);
+            int distance = std::max(0, destination_column - start_column);
+            int hurdles = lanes_orig[destination_lane + MAX_K].pop_count_between(start_column, destination_column);
+            int hurdle_cost = std::max(0, x * hurdles);
+            cost += switch_cost + hurdle_cost;
+#ifdef DISPLAY
+            // update matched strings
+            _update_match(destination_lane, current_lane, distance);
+#endif
+            // update CIGAR string
+            _update_CIGAR(destination_lane, current_lane, distance, 0);
+        }
+    }
+
+    /**
+     * Calculate the cost that _finish() would add if the path stopped at the given position.
+     * @param lane the lane where the path stops.
+     * @param column the column where the path stops.
+     * @return the cost of leaping to the destination lane and walking to the destination.
+     */
+    int _finishing_cost(int lane, int column) {
+        int destination_column = (*highway_list)[destination_lane].destination;
+        if (lane == destination_lane && column >= destination_column) {
+            return 0;
+        }
+        int switch_cost = 0;
+        if (alignment_type == GLOBAL) {
+            switch_cost = switch_lane_penalty(lane, destination_lane, o, e);
+        }
+        int distance = lanes_orig[destination_lane + MAX_K].pop_count_between(column + switch_forward_column(lane, destination_lane), destination_column);
+        return switch_cost + std::max(0, x * distance);
+    }
+
     /**
      * Construct 128-bit boolean vectors where the i-th element stores whether
      * read[i] matches ref[i+shift], where shift is the lane id that is between
      * -k and k. Store everything in `lanes`.
      */
     void _construct_hurdles() {
+        for (int lane = lower_bound; lane <= upper_bound; lane++) {
+            auto mask = _lane_hurdles(lane);
+            lanes_orig[lane + MAX_K] = mask;
+            lanes[lane + MAX_K] = mask.flip_short_hurdles(1);//.flip_short_matches(1);
+        }
+        // _finish() walks on the destination lane even if it is outside of the band
+        if ((destination_lane < lower_bound || destination_lane > upper_bound) && abs(destination_lane) <= MAX_K) {
+            lanes_orig[destination_lane + MAX_K] = _lane_hurdles(destination_lane);
+        }
+    }
+
+    /**
+     * Compute the hurdles of a lane from the bit masks of A and B, without storing them.
+     * @param lane the lane, which does not need to be inside the band.
+     * @return bit array where a 1 marks a mismatch.
+     */
+    T _lane_hurdles(int lane) {
         T mask_bit0, mask_bit1;
+        if (lane < 0) {
+            mask_bit0 = (A_bit0_mask->shift_left(-lane))._xor(*B_bit0_mask);
+            mask_bit1 = (A_bit1_mask->shift_left(-lane))._xor(*B_bit1_mask);
+        } else {
+            mask_bit0 = (B_bit0_mask->shift_left(lane))._xor(*A_bit0_mask);
+            mask_bit1 = (B_bit1_mask->shift_left(lane))._xor(*A_bit1_mask);
+        }
+        return mask_bit0._or(mask_bit1);
+    }
+
+    /**
+     * Count the characters of A that have no match on any lane between `low` and `high`.
+     * In an alignment that stays within these lanes, each of them is either a mismatch or
+     * an insertion. Positions outside of B count as mismatches.
+     * @param low the lowest lane.
+     * @param high the highest lane.
+     * @return number of unmatchable characters of A.
+     */
+    int _unmatchable_characters(int low, int high) {
+        T zero = A_bit0_mask->_xor(*A_bit0_mask);
+        T uncovered = zero._not();
+        for (int lane = std::max(low, -m); lane <= std::min(high, n); lane++) {
+            // index the lane by the position in A, i.e. bit i compares A[i] with B[i + lane]
+            T hurdles = lane < 0 ? _lane_hurdles(lane).shift_right(-lane) : _lane_hurdles(lane);
+            int first = std::max(0, -lane), last = std::min(m, n - lane);
+            T valid = zero;
+            if (last > first) {
+                valid = zero._not().shift_left(T::width - (last - first)).shift_right(first);
+            }
+            uncovered = uncovered._and(hurdles._or(valid._not()));
+        }
+        return uncovered.pop_count_between(0, m);
+    }
+
+    /**
+     * Set the band width, rebuild the hurdle lanes from the bit masks that are already
+     * converted and move back to the starting position. The strings are not re-encoded,
+     * so this is cheap enough to call again when re-running with a wider band.
+     * @param error band width
+     */
+    void _reset_band(int error) {
+        k = std::min(error, MAX_K);
+
+#ifdef CORRECTION
+        if (m <= n) {
+            lower_bound = -k;
+            upper_bound = std::min(MAX_K, n - m + k);
+        } else {
+            lower_bound = std::max(-MAX_K, n - m - k);
+            upper_bound = k;
+        }
+#else
+        lower_bound = -k;
+        upper_bound = k;
+#endif
+
+        highway_list->reset(k, m, n, lower_bound, upper_bound);
+        destination_lane = n - m;
+        is_first_step = true;
+        num_steps = 0;
+        termination = COMPLETED;
+        _construct_hurdles();
+
+        // define starting position at (0, 0)
+        current_lane = 0;
+        current_column = 0;
+        lowest_lane = highest_lane = 0;
+        cost = 0;
+
+#ifdef DISPLAY
+        A_index = 0, B_index = 0, A_match_index = 0, B_match_index = 0;
+#endif
+        // initialize CIGAR string
+        CIGAR.clear();
+    }
+
+    /**
+     * Reverse string A and B in their bit masks, so that the hurdle lanes built afterwards
+     * describe the alignment from right to left. No character is re-encoded.
+     */
+    void _reverse_read() {
+        *A_bit0_mask = A_bit0_mask->reverse(m);
+        *A_bit1_mask = A_bit1_mask->reverse(m);
+        *B_bit0_mask = B_bit0_mask->reverse(n);
+        *B_bit1_mask = B_bit1_mask->reverse(n);
+#ifdef DISPLAY
+        std::reverse(A_orig, A_orig + m);
+        std::reverse(B_orig, B_orig + n);
+#endif
+    }
+
+    /**
+     * Reverse the order of the operations in the CIGAR string, turning the CIGAR of the
+     * right-to-left alignment into that of the left-to-right alignment.
+     */
+    void _reverse_CIGAR() {
+        std::string reversed;
+        reversed.reserve(CIGAR.size());
+        size_t end = CIGAR.size();
+        while (end > 0) {
+            size_t start = end - 1;
+            while (start > 0 && isdigit(CIGAR[start - 1])) {
+                start--;
+            }
+            reversed.append(CIGAR, start, end - start);
+            end = start;
+        }
+        CIGAR = reversed;
+    }
+
+    /**
+     * Expand a partial path of the beam search by one step. The highway list is rebuilt
+     * from the position of the path, and the path leaps to the highway of each lane whose
+     * finished cost is among the `beam_width` lowest, plus the lane the greedy algorithm
+     * would choose. The new paths are appended to `candidates`.
+     * @param path the path to expand.
+     * @param first whether this is the first step of the path.
+     * @param beam_width the maximum number of new paths.
+     * @param candidates the list that the new paths are appended to.
+     */
+    void _expand_path(const beam_path& path, bool first, int beam_width, std::vector<beam_path>& candidates) {
+        current_lane = path.lane;
+        current_column = path.column;
+        is_first_step = first;
+        highway_list->reset(k, m, n, lower_bound, upper_bound);
+        if (!_update_highway_list()) {
+            // no highway left, the path goes straight to the destination
+            candidates.push_back(path);
+            candidates.back().is_finished = true;
+            return;
+        }
+        int greedy_lane = path.is_greedy ? _choose_best_highway() : highway_list->best_highway_lane;
+
+        // rank the lanes by the cost of the complete alignment through their highways
+        int num_lanes = 0;
+        int lane_order[2 * MAX_K + 1];
+        int lane_cost[2 * MAX_K + 1];
         for (int lane = lower_bound; lane <= upper_bound; lane++) {
-            if (lane < 0) {
-                mask_bit0 = (A_bit0_mask->shift_left(-lane))._xor(*B_bit0_mask);
-                mask_bit1 = (A_bit1_mask->shift_left(-lane))._xor(*B_bit1_mask);
+            int column = (*highway_list)[lane].starting_point + (*highway_list)[lane].length;
+            if (lane != greedy_lane && (column <= current_column || (*highway_list)[lane].length <= 0)) {
+                continue;
+            }
+            lane_cost[lane + MAX_K] = path.cost + (*highway_list)[lane].switch_cost +
+                                      (*highway_list)[lane].hurdle_cost + _finishing_cost(lane, column);
+            lane_order[num_lanes++] = lane;
+        }
+        int num_kept = std::min(num_lanes, beam_width);
+        std::partial_sort(lane_order, lane_order + num_kept, lane_order + num_lanes, [&](int a, int b) {
+            return lane_cost[a + MAX_K] < lane_cost[b + MAX_K];
+        });
+        bool greedy_kept = false;
+        for (int i = 0; i < num_kept; i++) {
+            greedy_kept = greedy_kept || lane_order[i] == greedy_lane;
+        }
+        if (!greedy_kept) {
+            lane_order[num_kept++] = greedy_lane;
+        }
+
+        for (int i = 0; i < num_kept; i++) {
+            int lane = lane_order[i];
+            beam_path child;
+            child.lane = lane;
+            child.column = (*highway_list)[lane].starting_point + (*highway_list)[lane].length;
+            child.cost = path.cost + (*highway_list)[lane].switch_cost + (*highway_list)[lane].hurdle_cost;
+            child.finished_cost = lane_cost[lane + MAX_K];
+            child.lowest_lane = std::min(path.lowest_lane, lane);
+            child.highest_lane = std::max(path.highest_lane, lane);
+            child.is_greedy = path.is_greedy && lane == greedy_lane;
+            child.is_finished = child.column >= (*highway_list)[lane].destination;
+            int distance = child.column - (current_column + switch_forward_column(current_lane, lane));
+            CIGAR = path.CIGAR;
+            _update_CIGAR(lane, current_lane, distance - (*highway_list)[lane].length, (*highway_list)[lane].length);
+            child.CIGAR = std::move(CIGAR);
+            candidates.push_back(std::move(child));
+        }
+    }
+
+    /**
+     * Check whether the path of the last run reached the lowest or highest lane of the
+     * band, in which case a wider band may give a cheaper path.
+     */
+    bool _hits_band_edge() const {
+        return (lowest_lane <= lower_bound && lower_bound > -MAX_K) ||
+               (highest_lane >= upper_bound && upper_bound < MAX_K);
+    }
+
+    /**
+     * Return the character at `index` of A (or B) as its 2-bit code, recovered from the bit masks.
+     */
+    static char _base_code(T* bit0_mask, T* bit1_mask, int index) {
+        return static_cast<char>('0' + bit0_mask->test_bit(index) + 2 * bit1_mask->test_bit(index));
+    }
+
+    /**
+     * Calculate the cost of a part of the path, given as one operation per column.
+     * @param operations the operations (M, I or D) of the part.
+     * @param i, j the position in A and B where the part starts.
+     * @return the cost of the part.
+     */
+    int _segment_cost(const std::string& operations, int i, int j) {
+        int segment_cost = 0;
+        for (size_t t = 0; t < operations.size(); t++) {
+            if (operations[t] == 'M') {
+                segment_cost += x * (_base_code(A_bit0_mask, A_bit1_mask, i) != _base_code(B_bit0_mask, B_bit1_mask, j));
+                i++, j++;
             } else {
-                mask_bit0 = (B_bit0_mask->shift_left(lane))._xor(*A_bit0_mask);
-                mask_bit1 = (B_bit1_mask->shift_left(lane))._xor(*A_bit1_mask);
+                // open a gap at the first operation of a run, extend it otherwise
+                segment_cost += (t > 0 && operations[t - 1] == operations[t]) ? e : o;
+                operations[t] == 'I' ? i++ : j++;
             }
-            auto mask = mask_bit0._or(mask_bit1);
-            lanes_orig[lane + MAX_K] = mask;
-            lanes[lane + MAX_K] = mask.flip_short_hurdles(1);//.flip_short_matches(1);
+        }
+        return segment_cost;
+    }
+
+    /**
+     * Append a run of `length` operations `op` to a CIGAR string, merging it with the last run
+     * if it has the same operation.
+     */
+    static void _append_run(std::string& cigar, int& last_length, char& last_op, int length, char op) {
+        if (length <= 0) {
+            return;
+        }
+        if (op == last_op) {
+            last_length += length;
+        } else {
+            if (last_length > 0) {
+                cigar += std::to_string(last_length);
+                cigar += last_op;
+            }
+            last_length = length;
+            last_op = op;
         }
     }
 
@@ -493,7 +945,10 @@ public:
         o = _o;
         e = _e;
 
-        // assign to class parameters
+        // assign to class parameters, clearing what is left of the previous strings, as
+        // _convert_read() encodes the whole buffer
+        memset(A, 0, MAX_LENGTH);
+        memset(B, 0, MAX_LENGTH);
         strncpy(A, read, m);
         strncpy(B, ref, n);
         k = error;
@@ -511,18 +966,26 @@ public:
         upper_bound = k;
 #endif
 
+        A_bit0_mask = new T;
+        A_bit1_mask = new T;
+        B_bit0_mask = new T;
+        B_bit1_mask = new T;
         _convert_read();
         highway_list = new highways(MAX_K, m, n, lower_bound, upper_bound);
         lanes = new T[2 * MAX_K + 1];
         lanes_orig = new T[2 * MAX_K + 1];
         destination_lane = n - m;
         is_first_step = true;
+        num_steps = 0;
+        termination = COMPLETED;
         _construct_hurdles();
 
         // define starting position at (0, 0)
         current_lane = 0;
         current_column = 0;
+        lowest_lane = highest_lane = 0;
         cost = 0;
+        NM = 0;
 
 #ifdef DISPLAY
         strncpy(A_orig, read, m);
@@ -532,6 +995,8 @@ public:
         // initialize CIGAR string
         CIGAR.reserve(MAX_LENGTH * sizeof(char));
 
+        polisher = banded_dp(x, o, e);
+
         // calculate significance for match/mismatch/indel
         match_sig = log(match_prob / 0.25);
         mismatch_sig = log(mismatch_prob / 0.25);
@@ -563,37 +1028,297 @@ public:
 
 
     /**
-     * Run the greedy algorithm for several steps.
+     * Run the greedy algorithm for several steps, stopping early if the accumulated cost
+     * exceeds max_cost or more than max_steps steps are taken. If the run is aborted,
+     * the cost and CIGAR only cover the part of the path that has been walked.
+     * @param max_cost the cost budget. Default: no limit.
+     * @param max_steps the maximum number of greedy steps. Default: no limit.
+     * @return the reason why the algorithm stopped.
      */
-    void run() {
+    termination_t run(int max_cost = std::numeric_limits<int>::max(),
+                      int max_steps = std::numeric_limits<int>::max()) {
         bool flag = false;
         while (!flag) {
+            if (num_steps >= max_steps) {
+                termination = STEPS_EXCEEDED;
+                return termination;
+            }
             flag = _step();
+            num_steps++;
             is_first_step = false;
-        }
-        // Check if we reach the final destination
-        int destination_column = (*highway_list)[destination_lane].destination;
-        if (current_lane != destination_lane || current_column < destination_column) {
-            int switch_cost = 0;
-            if (alignment_type == GLOBAL) {
-                switch_cost = switch_lane_penalty(current_lane, destination_lane, o, e);
+            if (cost > max_cost) {
+                termination = COST_EXCEEDED;
+                return termination;
             }
-            int distance = lanes_orig[destination_lane + MAX_K].pop_count_between(current_column + switch_forward_column(current_lane, destination_lane), destination_column);
-            int hurdle_cost = std::max(0, x * distance);
-            cost += switch_cost + hurdle_cost;
-#ifdef DISPLAY
-            // update matched strings
-            _update_match(destination_lane, current_lane, hurdle_cost);
-#endif
-            // update CIGAR string
-            _update_CIGAR(destination_lane, current_lane, distance, 0);
         }
+        _finish();
 #ifdef DISPLAY
         A_match[A_match_index] = '\0';
         B_match[B_match_index] = '\0';
         printf("%s\n%s\n", A_match, B_match);
 #endif
         //printf("total cost: %d", cost);
+        termination = cost > max_cost ? COST_EXCEEDED : COMPLETED;
+        return termination;
+    }
+
+    /**
+     * Estimate the band width needed for the current pair from cheap signals: the
+     * difference in length, and the number of columns where none of the lanes in that
+     * band has a match (the SHD of the band). Must be called after reset().
+     * @param min_k the smallest band width to return.
+     * @param max_k the largest band width to return.
+     * @return estimated band width.
+     */
+    int estimate_band(int min_k = 1, int max_k = MAX_K) {
+        int band = std::min(max_k, std::max(min_k, abs(n - m) + 1));
+        int length = std::min(m, n);
+        while (true) {
+            _reset_band(band);
+            if (band >= max_k) {
+                return band;
+            }
+            // columns without a match in any lane of the band
+            T uncovered = lanes_orig[lower_bound + MAX_K];
+            for (int lane = lower_bound + 1; lane <= upper_bound; lane++) {
+                uncovered = uncovered._and(lanes_orig[lane + MAX_K]);
+            }
+            if (SHD_WIDEN_RATIO * uncovered.pop_count_between(0, length) <= length) {
+                return band;
+            }
+            band = std::min(max_k, 2 * band);
+        }
+    }
+
+    /**
+     * Run the greedy algorithm with an adaptive band. Start with the band given by
+     * estimate_band() and re-run with a doubled band only if the path touched the edge
+     * of the band or the cost is worse than staying on the main diagonal. Keep the
+     * cheapest of the runs: if the wider band does not help, the narrower band is run
+     * again, so the object is left as after a plain run() with the returned band.
+     * Must be called after reset().
+     * @param min_k the smallest band width to use.
+     * @param max_k the largest band width to escalate to.
+     * @param max_cost the cost budget of each run. Default: no limit.
+     * @param max_steps the maximum number of greedy steps of each run. Default: no limit.
+     * @return the reason why the last kept run stopped.
+     */
+    termination_t run_adaptive(int min_k = 1, int max_k = MAX_K,
+                               int max_cost = std::numeric_limits<int>::max(),
+                               int max_steps = std::numeric_limits<int>::max()) {
+        max_k = std::min(max_k, MAX_K);
+        estimate_band(min_k, max_k);
+        run(max_cost, max_steps);
+        while (termination == COMPLETED && k < max_k && (_hits_band_edge() || cost > diagonal_cost())) {
+            int previous_k = k;
+            int previous_cost = cost;
+            _reset_band(std::min(max_k, 2 * k));
+            run(max_cost, max_steps);
+            if (termination != COMPLETED || cost > previous_cost) {
+                // the wider band did not help, run the previous band again, so that the band,
+                // lanes and statistics describe the returned path
+                _reset_band(previous_k);
+                run(max_cost, max_steps);
+                break;
+            }
+        }
+        return termination;
+    }
+
+    /**
+     * Run the greedy algorithm from left to right and then from right to left, and keep
+     * the cheaper of the two paths. Both passes use the same bit masks and buffers; the
+     * reverse pass only bit-reverses the masks and rebuilds the lanes. The reverse pass
+     * is skipped if the forward path already costs no more than the gap between the
+     * string lengths. Only GLOBAL alignment is run in both directions. Afterwards the hurdle
+     * lanes are left to right again, and the lanes, steps and position describe the kept
+     * pass (the lanes of the reverse pass in its own, mirrored band), so that
+     * hits_band_edge(), get_lower_bound() and is_certified() hold for the returned path.
+     * Must be called after reset().
+     * @param max_cost the cost budget of each pass. Default: no limit.
+     * @param max_steps the maximum number of greedy steps of each pass. Default: no limit.
+     * @return the reason why the kept pass stopped.
+     */
+    termination_t run_bidirectional(int max_cost = std::numeric_limits<int>::max(),
+                                    int max_steps = std::numeric_limits<int>::max()) {
+        run(max_cost, max_steps);
+        if (alignment_type != GLOBAL ||
+            (termination == COMPLETED && cost <= switch_lane_penalty(0, destination_lane, o, e))) {
+            return termination;
+        }
+        int forward_cost = cost;
+        int forward_steps = num_steps;
+        termination_t forward_termination = termination;
+        int forward_lowest_lane = lowest_lane, forward_highest_lane = highest_lane;
+        int forward_lane = current_lane, forward_column = current_column;
+        std::string forward_CIGAR = std::move(CIGAR);
+
+        _reverse_read();
+        _reset_band(k);
+        run(max_cost, max_steps);
+        _reverse_CIGAR();
+        // restore the left-to-right hurdles for the methods called after the run
+        _reverse_read();
+        _construct_hurdles();
+        if ((termination != COMPLETED && forward_termination == COMPLETED) ||
+            (termination == forward_termination && cost >= forward_cost)) {
+            // the reverse pass did not help, keep the forward result
+            cost = forward_cost;
+            termination = forward_termination;
+            num_steps = forward_steps;
+            lowest_lane = forward_lowest_lane;
+            highest_lane = forward_highest_lane;
+            current_lane = forward_lane;
+            current_column = forward_column;
+            CIGAR = std::move(forward_CIGAR);
+        }
+        return termination;
+    }
+
+    /**
+     * Run the greedy algorithm as a beam search that keeps the `beam_width` partial paths
+     * whose complete alignments (leaping to the destination lane right away) are the
+     * cheapest. Paths that reach the same lane and column are merged, keeping the
+     * cheapest one. The path that takes the greedy choice at every step stays in the beam,
+     * but as each step rebuilds the highway list from the position of the path, it may
+     * differ from the path of run(). So run() is also performed first, and its result is
+     * kept unless the beam finds a cheaper one; `beam_width` = 1 is the same as run().
+     * Matched strings are not displayed for beam_width > 1. Must be called after reset().
+     * @param beam_width the number of partial paths to keep.
+     * @param max_cost the cost budget of the greedy run and of the beam. Default: no limit.
+     * @param max_steps the maximum number of steps of the greedy run and of the beam. Default: no limit.
+     * @return the reason why the algorithm stopped.
+     */
+    termination_t run_beam(int beam_width,
+                           int max_cost = std::numeric_limits<int>::max(),
+                           int max_steps = std::numeric_limits<int>::max()) {
+        if (beam_width <= 1) {
+            return run(max_cost, max_steps);
+        }
+        // the result of the plain greedy algorithm, which the beam has to beat
+        run(max_cost, max_steps);
+        int greedy_cost = cost;
+        int greedy_steps = num_steps;
+        termination_t greedy_termination = termination;
+        int greedy_lowest_lane = lowest_lane, greedy_highest_lane = highest_lane;
+        std::string greedy_CIGAR = std::move(CIGAR);
+        _reset_band(k);
+
+        std::vector<beam_path> beam, candidates;
+        beam_path start;
+        start.lane = current_lane;
+        start.column = current_column;
+        start.cost = cost;
+        start.finished_cost = _finishing_cost(current_lane, current_column);
+        start.lowest_lane = start.highest_lane = current_lane;
+        start.is_greedy = true;
+        start.is_finished = false;
+        beam.push_back(start);
+
+        beam_path best;
+        best.cost = std::numeric_limits<int>::max();
+        beam_path cheapest_aborted;
+        cheapest_aborted.cost = std::numeric_limits<int>::max();
+        termination = COMPLETED;
+        bool first = true;
+        while (!beam.empty()) {
+            if (num_steps >= max_steps) {
+                termination = STEPS_EXCEEDED;
+                cheapest_aborted = beam.front();
+                break;
+            }
+            candidates.clear();
+            for (auto& path : beam) {
+                _expand_path(path, first, beam_width, candidates);
+            }
+            num_steps++;
+            first = false;
+
+            // finish the paths that reach the destination and drop those over the budget
+            beam.clear();
+            for (auto& path : candidates) {
+                if (path.is_finished) {
+                    current_lane = path.lane;
+                    current_column = path.column;
+                    cost = path.cost;
+                    CIGAR = std::move(path.CIGAR);
+                    _finish();
+                    if (cost < best.cost) {
+                        best.cost = cost;
+                        best.lowest_lane = path.lowest_lane;
+                        best.highest_lane = path.highest_lane;
+                        best.CIGAR = std::move(CIGAR);
+                    }
+                } else if (path.cost > max_cost) {
+                    if (path.cost < cheapest_aborted.cost) {
+                        cheapest_aborted = std::move(path);
+                    }
+                } else if (path.cost < best.cost) {
+                    beam.push_back(std::move(path));
+                }
+            }
+
+            // merge paths at the same position and keep the cheapest ones
+            std::sort(beam.begin(), beam.end(), [](const beam_path& a, const beam_path& b) {
+                if (a.lane != b.lane) return a.lane < b.lane;
+                if (a.column != b.column) return a.column < b.column;
+                return a.cost < b.cost;
+            });
+            size_t num_unique = 0;
+            for (size_t i = 0; i < beam.size(); i++) {
+                if (num_unique > 0 && beam[i].lane == beam[num_unique - 1].lane &&
+                    beam[i].column == beam[num_unique - 1].column) {
+                    // the greedy path continues from the cheaper path at the same position
+                    beam[num_unique - 1].is_greedy = beam[num_unique - 1].is_greedy || beam[i].is_greedy;
+                    continue;
+                }
+                if (i != num_unique) {
+                    beam[num_unique] = std::move(beam[i]);
+                }
+                num_unique++;
+            }
+            beam.resize(num_unique);
+            std::sort(beam.begin(), beam.end(), [](const beam_path& a, const beam_path& b) {
+                if (a.finished_cost != b.finished_cost) return a.finished_cost < b.finished_cost;
+                return a.cost < b.cost;
+            });
+            if (beam.size() > (size_t) beam_width) {
+                for (size_t i = beam_width; i < beam.size(); i++) {
+                    if (beam[i].is_greedy) {
+                        beam[beam_width - 1] = std::move(beam[i]);
+                        break;
+                    }
+                }
+                beam.resize(beam_width);
+            }
+        }
+
+        if (best.cost != std::numeric_limits<int>::max()) {
+            cost = best.cost;
+            lowest_lane = best.lowest_lane;
+            highest_lane = best.highest_lane;
+            CIGAR = std::move(best.CIGAR);
+            termination = COMPLETED;
+        } else {
+            if (termination == COMPLETED) {
+                termination = COST_EXCEEDED;
+            }
+            cost = cheapest_aborted.cost;
+            CIGAR = std::move(cheapest_aborted.CIGAR);
+        }
+
+        // keep the greedy result unless the beam is better: completed while the greedy run
+        // was aborted, or with the same termination and a lower cost
+        if (greedy_termination == COMPLETED ? (termination != COMPLETED || cost >= greedy_cost) :
+                                              (termination != COMPLETED && cost >= greedy_cost)) {
+            cost = greedy_cost;
+            termination = greedy_termination;
+            lowest_lane = greedy_lowest_lane;
+            highest_lane = greedy_highest_lane;
+            CIGAR = std::move(greedy_CIGAR);
+        }
+        num_steps += greedy_steps;
+        return termination;
     }
 
     /**
@@ -610,7 +1335,7 @@ public:
      * Get the CIGAR string. Must be called after run().
      * @return CIGAR string.
      */
-    std::string get_CIGAR() {
+    const std::string& get_CIGAR() const {
         return CIGAR;
     }
 
@@ -626,42 +1351,19 @@ public:
         m = std::min(MAX_LENGTH, read_len);
         n = std::min(MAX_LENGTH, ref_len);
 
-        // assign to class parameters
+        // assign to class parameters, clearing what is left of the previous strings, as
+        // _convert_read() encodes the whole buffer
+        memset(A, 0, MAX_LENGTH);
+        memset(B, 0, MAX_LENGTH);
         strncpy(A, read, m);
         strncpy(B, ref, n);
-        k = error;
-
-#ifdef CORRECTION
-        if (m <= n) {
-            lower_bound = -k;
-            upper_bound = n - m + k;
-        } else {
-            lower_bound = n - m - k;
-            upper_bound = k;
-        }
-#else
-        lower_bound = -k;
-        upper_bound = k;
-#endif
 
         _convert_read();
-        highway_list->reset(k, m, n, lower_bound, upper_bound);
-        destination_lane = n - m;
-        is_first_step = true;
-        _construct_hurdles();
-
-        // define starting position at (0, 0)
-        current_lane = 0;
-        current_column = 0;
-        cost = 0;
-
 #ifdef DISPLAY
         strncpy(A_orig, read, m);
         strncpy(B_orig, ref, n);
-        A_index = 0, B_index = 0, A_match_index = 0, B_match_index = 0;
 #endif
-        // initialize CIGAR string
-        CIGAR.clear();
+        _reset_band(error);
     }
 
     void reset(const char* read, const char* ref, int error) {
@@ -670,6 +1372,42 @@ public:
         reset(read, read_len, ref, ref_len, error);
     }
 
+    /**
+     * Reset the object with strings that are already 2-bit packed (4 bases per byte, first base
+     * in the lowest two bits, A = 0, C = 1, G = 2, T = 3). The bit masks are built directly
+     * from the packed bytes, without going through characters.
+     * @param read the packed read.
+     * @param read_len number of bases of the read.
+     * @param ref the packed reference.
+     * @param ref_len number of bases of the reference.
+     * @param error band width
+     */
+    void reset_packed(const uint8_t* read, const int read_len, const uint8_t* ref, const int ref_len, int error) {
+        m = std::min({MAX_LENGTH, T::width, read_len});
+        n = std::min({MAX_LENGTH, T::width, ref_len});
+
+        uint8_t A_bit0_t[T::width / 8] GASMA_ALIGNED = {};
+        uint8_t A_bit1_t[T::width / 8] GASMA_ALIGNED = {};
+        uint8_t B_bit0_t[T::width / 8] GASMA_ALIGNED = {};
+        uint8_t B_bit1_t[T::width / 8] GASMA_ALIGNED = {};
+        split_2bit_packed(read, m, A_bit0_t, A_bit1_t);
+        split_2bit_packed(ref, n, B_bit0_t, B_bit1_t);
+        *A_bit0_mask = T(A_bit0_t);
+        *A_bit1_mask = T(A_bit1_t);
+        *B_bit0_mask = T(B_bit0_t);
+        *B_bit1_mask = T(B_bit1_t);
+#ifdef DISPLAY
+        static const char bases[] = "ACGT";
+        for (int i = 0; i < m; i++) {
+            A_orig[i] = bases[_base_code(A_bit0_mask, A_bit1_mask, i) - '0'];
+        }
+        for (int j = 0; j < n; j++) {
+            B_orig[j] = bases[_base_code(B_bit0_mask, B_bit1_mask, j) - '0'];
+        }
+#endif
+        _reset_band(error);
+    }
+
     /**
      * Return the penalty (non-negative) of the alignment.
      * @return total penalty
@@ -678,9 +1416,289 @@ public:
         return cost;
     }
 
+    /**
+     * Return the reason why the last run() stopped.
+     * @return COMPLETED, COST_EXCEEDED or STEPS_EXCEEDED.
+     */
+    termination_t get_termination() const {
+        return termination;
+    }
+
+    /**
+     * Return the number of greedy steps performed in the last run().
+     * @return number of steps
+     */
+    int get_num_steps() const {
+        return num_steps;
+    }
+
+    /**
+     * Check whether the path of the last run() reached the edge of the band, in which
+     * case a wider band may give a cheaper path.
+     */
+    bool hits_band_edge() const {
+        return _hits_band_edge();
+    }
+
+    /**
+     * Return the band width used in the last run().
+     * @return band width
+     */
+    int get_band() const {
+        return k;
+    }
+
+    /**
+     * Return the cost of the trivial path that stays on lane 0 and leaps to the destination
+     * lane at the end. It is an upper bound of the optimal cost. Must be called after reset().
+     * @return cost of the diagonal path
+     */
+    int diagonal_cost() {
+        int switch_cost = alignment_type == GLOBAL ? switch_lane_penalty(0, destination_lane, o, e) : 0;
+        return switch_cost + x * lanes_orig[MAX_K].pop_count_between(0, std::min(m, n));
+    }
+
+    /**
+     * Polish the path of the last run() around its leaps, where most greedy mistakes are. For
+     * each leap, the path from `window` operations before it to `window` operations after it
+     * is re-aligned with an exact DP, and replaced if the DP finds a cheaper way between the two
+     * ends. Leaps closer than the window share one DP. Long highways are left untouched, so the
+     * work grows with the number of leaps instead of the length of the strings. Only GLOBAL
+     * alignment is supported. The matched strings (DISPLAY) are not updated.
+     * Must be called after run().
+     * @param window number of operations on each side of a leap to re-align. Default: POLISH_WINDOW.
+     * @return number of windows where a cheaper path was found.
+     */
+    int polish(int window = POLISH_WINDOW) {
+        if (alignment_type != GLOBAL || termination != COMPLETED) {
+            return 0;
+        }
+        std::string operations = expand_CIGAR(CIGAR);
+        int total = static_cast<int>(operations.size());
+        // windows start and end at the ends of the path or between two matches, so that no gap is cut in two
+        auto is_boundary = [&](int t) {
+            return t == 0 || t == total || (operations[t - 1] == 'M' && operations[t] == 'M');
+        };
+
+        std::string polished;
+        polished.reserve(total);
+        std::string read_window, ref_window;
+        int improved = 0;
+        int i = 0, j = 0;   // position in A and B after the operations copied to `polished`
+        int done = 0;       // number of operations copied to `polished`
+        for (int t = 0; t < total; t++) {
+            if (operations[t] == 'M') {
+                continue;
+            }
+            int start = std::max(done, t - window);
+            while (!is_boundary(start)) {
+                start--;
+            }
+            int end = t;
+            while (end < total && operations[end] != 'M') {
+                end++;
+            }
+            end = std::min(total, end + window);
+            while (!is_boundary(end)) {
+                end++;
+            }
+
+            // copy the operations before the window
+            for (; done < start; done++) {
+                polished += operations[done];
+                if (operations[done] != 'D') i++;
+                if (operations[done] != 'I') j++;
+            }
+
+            // re-align the window and keep the cheaper path
+            std::string segment = operations.substr(start, end - start);
+            int segment_cost = _segment_cost(segment, i, j);
+            int read_length = static_cast<int>(std::count_if(segment.begin(), segment.end(), [](char op) { return op != 'D'; }));
+            int ref_length = static_cast<int>(std::count_if(segment.begin(), segment.end(), [](char op) { return op != 'I'; }));
+            read_window.clear();
+            ref_window.clear();
+            for (int c = 0; c < read_length; c++) {
+                read_window += _base_code(A_bit0_mask, A_bit1_mask, i + c);
+            }
+            for (int c = 0; c < ref_length; c++) {
+                ref_window += _base_code(B_bit0_mask, B_bit1_mask, j + c);
+            }
+            polisher.reset(read_window.c_str(), read_length, ref_window.c_str(), ref_length);
+            if (segment_cost > 0 && polisher.run(segment_cost - 1) == COMPLETED) {
+                polished += expand_CIGAR(polisher.get_CIGAR());
+                improved++;
+            } else {
+                polished += segment;
+            }
+            i += read_length;
+            j += ref_length;
+            done = end;
+            t = end - 1;
+        }
+        polished.append(operations, done, std::string::npos);
+        if (improved > 0) {
+            // two windows sharing a boundary may both put a gap there, which becomes one gap in
+            // the spliced path, so the cost is computed from the whole path
+            cost = _segment_cost(polished, 0, 0);
+            CIGAR = compress_CIGAR(polished);
+        }
+        return improved;
+    }
+
+    /**
+     * Split the matches and mismatches of the last path, and compute the SAM NM and MD tags,
+     * without comparing the strings again: the hurdles of the lane of each M run are scanned
+     * for their set bits, which are exactly the mismatches. Characters other than A, C, G and T
+     * are read as A. In SEMI_GLOBAL alignment the free deletions at both ends of the path are
+     * kept in the CIGAR string, but not counted in NM or MD, which start at the first aligned
+     * base of the reference. Must be called after run() (or polish()).
+     */
+    void resolve_mismatches() {
+        static const char bases[] = "ACGT";
+        extended_CIGAR.clear();
+        MD.clear();
+        NM = 0;
+        int last_length = 0;
+        char last_op = 0;
+        int md_matches = 0;     // matches since the last mismatch or deletion in MD
+
+        // find the part of the path that is not a free end gap
+        size_t first = 0, last = CIGAR.size();
+        if (alignment_type != GLOBAL && !CIGAR.empty()) {
+            size_t op = CIGAR.find_first_not_of("0123456789");
+            if (op != std::string::npos && CIGAR[op] == 'D') {
+                first = op + 1;
+            }
+            if (CIGAR.back() == 'D') {
+                size_t run = CIGAR.find_last_not_of("0123456789", CIGAR.size() - 2);
+                last = std::max(first, run == std::string::npos ? 0 : run + 1);
+            }
+        }
+
+        int i = 0, j = 0;
+        size_t index = 0;
+        while (index < CIGAR.size()) {
+            size_t run_begin = index;
+            int length = 0;
+            while (isdigit(CIGAR[index])) {
+                length = length * 10 + (CIGAR[index++] - '0');
+            }
+            char op = CIGAR[index++];
+            bool aligned = run_begin >= first && run_begin < last;
+            if (op == 'I') {
+                _append_run(extended_CIGAR, last_length, last_op, length, 'I');
+                NM += length;
+                i += length;
+            } else if (op == 'D') {
+                _append_run(extended_CIGAR, last_length, last_op, length, 'D');
+                if (aligned) {
+                    NM += length;
+                    MD += std::to_string(md_matches);
+                    MD += '^';
+                    for (int c = j; c < j + length; c++) {
+                        MD += bases[_base_code(B_bit0_mask, B_bit1_mask, c) - '0'];
+                    }
+                    md_matches = 0;
+                }
+                j += length;
+            } else {
+                // index the hurdles of the lane by the position in the shorter prefix, as in _lane_hurdles()
+                int lane = j - i;
+                int column = lane < 0 ? j : i;
+                T hurdles = _lane_hurdles(lane);
+                int done = 0;
+                while (done < length) {
+                    int mismatch = std::min(length, done + hurdles.shift_left(column + done).first_one());
+                    _append_run(extended_CIGAR, last_length, last_op, mismatch - done, '=');
+                    md_matches += mismatch - done;
+                    if (mismatch == length) {
+                        break;
+                    }
+                    _append_run(extended_CIGAR, last_length, last_op, 1, 'X');
+                    NM++;
+                    MD += std::to_string(md_matches);
+                    MD += bases[_base_code(B_bit0_mask, B_bit1_mask, j + mismatch) - '0'];
+                    md_matches = 0;
+                    done = mismatch + 1;
+                }
+                i += length;
+                j += length;
+            }
+        }
+        if (last_length > 0) {
+            extended_CIGAR += std::to_string(last_length);
+            extended_CIGAR += last_op;
+        }
+        MD += std::to_string(md_matches);
+    }
+
+    /**
+     * Get the CIGAR string with =/X for matches and mismatches. Must be called after resolve_mismatches().
+     */
+    const std::string& get_extended_CIGAR() const {
+        return extended_CIGAR;
+    }
+
+    /**
+     * Get the SAM MD tag, i.e. the reference bases at mismatches and deletions. Must be called
+     * after resolve_mismatches().
+     */
+    const std::string& get_MD() const {
+        return MD;
+    }
+
+    /**
+     * Get the SAM NM tag, i.e. the number of mismatches, inserted and deleted bases. Must be
+     * called after resolve_mismatches().
+     */
+    int get_NM() const {
+        return NM;
+    }
+
+    /**
+     * Return a lower bound of the optimal cost, proven from the hurdle lanes. Any alignment
+     * cheaper than the last run() can only leave the lanes between 0 and the destination by
+     * a few lanes, as each extra lane costs two gaps. Inside those lanes, every character of A
+     * that has no match on any lane costs at least a mismatch or a gap (the SHD of the band),
+     * and B needs at least n - m deletions if it is longer. Only GLOBAL alignment is supported,
+     * other alignment types return 0. Must be called after run().
+     * @return lower bound of the cost, never larger than the cost of the last run().
+     */
+    int get_lower_bound() {
+        int gap = std::min(o, e);
+        if (alignment_type != GLOBAL || gap <= 0) {
+            return 0;
+        }
+        int distance = abs(destination_lane);
+        if (termination != COMPLETED) {
+            return gap * distance;
+        }
+        if (cost <= gap * distance) {
+            return cost;
+        }
+        int excursion = ((cost - 1) / gap - distance) / 2;
+        int unmatched = std::min(x, gap) * _unmatchable_characters(std::min(0, destination_lane) - excursion,
+                                                                    std::max(0, destination_lane) + excursion);
+        int bound = destination_lane >= 0 ? unmatched + gap * distance : std::max(unmatched, gap * distance);
+        return std::min(cost, bound);
+    }
+
+    /**
+     * Check whether the last run() is proven optimal, i.e. its cost reaches get_lower_bound().
+     * Certified alignments do not need to be verified by an exact algorithm.
+     */
+    bool is_certified() {
+        return alignment_type == GLOBAL && termination == COMPLETED && get_lower_bound() == cost;
+    }
+
     ~hurdle_matrix() {
         delete highway_list;
         delete[] lanes;
+        delete[] lanes_orig;
+        delete A_bit0_mask;
+        delete A_bit1_mask;
+        delete B_bit0_mask;
+        delete B_bit1_mask;
     }
 };
 
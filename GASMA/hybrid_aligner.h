@@ -0,0 +1,276 @@
+#ifndef GASMA_HYBRID_ALIGNER_H
+#define GASMA_HYBRID_ALIGNER_H
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <string>
+
+#include "hurdle_matrix.h"
+#include "myers_matrix.h"
+
+#ifndef MAX_TRUSTED_LEAPS
+#define MAX_TRUSTED_LEAPS 0  // fall back if an uncertified greedy path leaps between lanes more often than this
+#endif
+
+/**
+ * Aligner that runs the greedy algorithm first, and re-aligns the pair with the exact
+ * bit-parallel engine only if the greedy result looks suspicious. A greedy result is trusted if
+ * 1. it is certified, i.e. its cost reaches the lower bound of hurdle_matrix::get_lower_bound(), or
+ * 2. the path stayed inside the band and leaped at most `max_trusted_leaps` times. Most greedy
+ *    mistakes are a wrong leap: on random 100 bp pairs with 2-10% errors and k = 3, 30-65% of the
+ *    uncertified paths with one or more leaps are suboptimal, against 0-6% of those without a
+ *    leap. Hence the default of MAX_TRUSTED_LEAPS = 0, i.e. an uncertified leap is never trusted.
+ * The exact engine only needs to find an alignment cheaper than the greedy one, so it stops as
+ * soon as this is impossible. Only the edit distance (x = o = e = 1) is supported.
+ * Both engines align the same extent: the strings are truncated to the shorter of MAX_LENGTH and
+ * the width of T, and in SEMI_GLOBAL alignment the CIGAR string always covers the whole
+ * reference, with the unaligned ends as deletions. The cost of a SEMI_GLOBAL alignment is its
+ * edit distance without these end deletions, for the results of both engines.
+ * @tparam T either `int_128bit` (SSE) or `int_256bit` (AVX2), shared by both engines.
+ */
+template <typename T>
+class hybrid_aligner {
+private:
+    // longest read and reference that both engines align in full
+    static constexpr int max_length = std::min(MAX_LENGTH, T::width);
+
+protected:
+    // the two engines
+    hurdle_matrix<T>* greedy;
+    myers_matrix<T>* exact;
+
+    // band width of the greedy algorithm
+    int k;
+
+    // type of alignment, either GLOBAL or SEMI_GLOBAL
+    alignment_type_t alignment_type;
+
+    // largest number of leaps for a greedy path to be trusted
+    int max_trusted_leaps;
+
+    // result of the last alignment
+    int cost;
+    std::string CIGAR;
+    bool used_fallback;
+    bool certified;
+
+    // statistics over all alignments since the last reset_statistics()
+    long num_alignments, num_fallbacks, num_improved;
+    double greedy_seconds, fallback_seconds;
+
+    /**
+     * Count the number of leaps, i.e. insertion and deletion runs, in a CIGAR string.
+     */
+    static int _count_leaps(const std::string& greedy_CIGAR) {
+        int leaps = 0;
+        for (char c : greedy_CIGAR) {
+            leaps += (c == 'I' || c == 'D');
+        }
+        return leaps;
+    }
+
+    /**
+     * Compute the edit distance along a path. In SEMI_GLOBAL alignment the deletions at both
+     * ends of the path are free.
+     */
+    int _path_cost(const char* read, const char* ref, const std::string& path_CIGAR) const {
+        std::string operations = expand_CIGAR(path_CIGAR);
+        size_t first = 0, last = operations.size();
+        if (alignment_type != GLOBAL) {
+            first = std::min(last, operations.find_first_not_of('D'));
+            last = operations.find_last_not_of('D') + 1;
+        }
+        int path_cost = 0;
+        int i = 0, j = 0;
+        for (size_t t = 0; t < operations.size(); t++) {
+            if (operations[t] == 'M') {
+                path_cost += read[i++] != ref[j++];
+            } else if (operations[t] == 'I') {
+                path_cost++;
+                i++;
+            } else {
+                path_cost += t >= first && t < last;
+                j++;
+            }
+        }
+        return path_cost;
+    }
+
+    /**
+     * Check whether the result of the greedy algorithm can be trusted.
+     */
+    bool _is_confident() {
+        if (greedy->get_termination() != COMPLETED) {
+            return false;
+        }
+        if (certified) {
+            return true;
+        }
+        if (greedy->hits_band_edge()) {
+            return false;
+        }
+        return _count_leaps(CIGAR) <= max_trusted_leaps;
+    }
+
+public:
+    /**
+     * Constructor of the hybrid aligner.
+     * @param _k band width of the greedy algorithm. Default: 3.
+     * @param _alignment_type the type of alignment, either GLOBAL or SEMI_GLOBAL. Default: GLOBAL.
+     * @param _max_trusted_leaps largest number of leaps for a greedy path to be trusted.
+     *                           Smaller values fall back more often. Default: MAX_TRUSTED_LEAPS.
+     */
+    explicit hybrid_aligner(int _k = 3,
+                            alignment_type_t _alignment_type = GLOBAL,
+                            int _max_trusted_leaps = MAX_TRUSTED_LEAPS) {
+        k = _k;
+        alignment_type = _alignment_type;
+        max_trusted_leaps = _max_trusted_leaps;
+        greedy = new hurdle_matrix<T>(_alignment_type);
+        exact = new myers_matrix<T>(_alignment_type, true);
+        cost = 0;
+        used_fallback = false;
+        certified = false;
+        reset_statistics();
+    }
+
+    hybrid_aligner(const hybrid_aligner&) = delete;
+    hybrid_aligner& operator=(const hybrid_aligner&) = delete;
+
+    /**
+     * Align the read to the reference. Strings longer than the shorter of MAX_LENGTH and the
+     * width of T are truncated.
+     * @param read the read string.
+     * @param read_len length of the read string.
+     * @param ref the reference string.
+     * @param ref_len length of the reference string.
+     * @return the cost of the alignment.
+     */
+    int align(const char* read, int read_len, const char* ref, int ref_len) {
+        auto start_time = std::chrono::steady_clock::now();
+        read_len = std::min(read_len, max_length);
+        ref_len = std::min(ref_len, max_length);
+        greedy->reset(read, read_len, ref, ref_len, k);
+        greedy->run();
+        CIGAR = greedy->get_CIGAR();
+        // the free end gaps of the greedy algorithm are not the same as those of the exact engine
+        cost = alignment_type == GLOBAL || greedy->get_termination() != COMPLETED ?
+               greedy->get_cost() : _path_cost(read, ref, CIGAR);
+        certified = greedy->is_certified();
+        used_fallback = !_is_confident();
+        auto greedy_end_time = std::chrono::steady_clock::now();
+        greedy_seconds += std::chrono::duration<double>(greedy_end_time - start_time).count();
+
+        if (used_fallback) {
+            num_fallbacks++;
+            exact->reset(read, read_len, ref, ref_len);
+            // only an alignment cheaper than the greedy one is of interest
+            int max_cost = greedy->get_termination() == COMPLETED ? cost - 1 : INT_MAX;
+            if (exact->run(max_cost) == COMPLETED) {
+                cost = exact->get_cost();
+                CIGAR = exact->get_CIGAR();
+                if (alignment_type != GLOBAL) {
+                    // cover the whole reference, as the greedy CIGAR string does
+                    CIGAR = compress_CIGAR(std::string(exact->get_ref_begin(), 'D') + expand_CIGAR(CIGAR) +
+                                           std::string(ref_len - exact->get_ref_end(), 'D'));
+                }
+                num_improved++;
+            }
+            certified = true;
+            fallback_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - greedy_end_time).count();
+        }
+        num_alignments++;
+        return cost;
+    }
+
+    int align(const char* read, const char* ref) {
+        int read_len = static_cast<int>(strlen(read));
+        int ref_len = static_cast<int>(strlen(ref));
+        return align(read, read_len, ref, ref_len);
+    }
+
+    /**
+     * Return the cost of the last alignment.
+     */
+    int get_cost() const {
+        return cost;
+    }
+
+    /**
+     * Get the CIGAR string of the last alignment.
+     */
+    const std::string& get_CIGAR() const {
+        return CIGAR;
+    }
+
+    /**
+     * Check whether the last alignment was re-run with the exact engine.
+     */
+    bool get_used_fallback() const {
+        return used_fallback;
+    }
+
+    /**
+     * Check whether the last alignment is proven optimal, either by the lower bound of the
+     * greedy result or by the exact engine.
+     */
+    bool get_certified() const {
+        return certified;
+    }
+
+    /**
+     * Set the largest number of leaps for a greedy path to be trusted.
+     */
+    void set_max_trusted_leaps(int leaps) {
+        max_trusted_leaps = leaps;
+    }
+
+    /**
+     * Return the fraction of alignments that were re-run with the exact engine.
+     */
+    double get_fallback_rate() const {
+        return num_alignments == 0 ? 0 : (double) num_fallbacks / num_alignments;
+    }
+
+    /**
+     * Return the fraction of alignments where the exact engine found a cheaper alignment.
+     */
+    double get_improvement_rate() const {
+        return num_alignments == 0 ? 0 : (double) num_improved / num_alignments;
+    }
+
+    /**
+     * Return the total time spent in the greedy algorithm and in the fallback, in seconds.
+     */
+    double get_greedy_time() const {
+        return greedy_seconds;
+    }
+
+    double get_fallback_time() const {
+        return fallback_seconds;
+    }
+
+    /**
+     * Return the effective time per alignment in seconds, including the fallbacks.
+     */
+    double get_time_per_alignment() const {
+        return num_alignments == 0 ? 0 : (greedy_seconds + fallback_seconds) / num_alignments;
+    }
+
+    /**
+     * Clear the fallback and timing statistics.
+     */
+    void reset_statistics() {
+        num_alignments = num_fallbacks = num_improved = 0;
+        greedy_seconds = fallback_seconds = 0;
+    }
+
+    ~hybrid_aligner() {
+        delete greedy;
+        delete exact;
+    }
+};
+
+
+#endif //GASMA_HYBRID_ALIGNER_H
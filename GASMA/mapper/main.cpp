@@ -82,8 +82,9 @@ void map_reads(std::filesystem::path const & query_path,
             matrix->reset(seqan_dna_to_cstring(query).c_str(),
                           query.size(),
                           seqan_dna_to_cstring(text_view).c_str(),
-                          text_view.size(), 3);
-            matrix->run();
+                          text_view.size(), 0);
+            // the hit has at most `errors` edits, so a wider band than errors + 1 cannot help
+            matrix->run_adaptive(1, std::max(3, errors + 1));
             std::pair<std::span<seqan3::dna5>, std::span<seqan3::dna5>> alignment = {query, text_view};
 
             sam_out.emplace_back(query,
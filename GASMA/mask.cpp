@@ -6,7 +6,7 @@
  * Mask for 1 bit bases
  */
 
-uint8_t __MASK_SSE_BEG1_ [128] __aligned = { 0xfe, 0xff, 0xff, 0xff, 0xff,
+uint8_t __MASK_SSE_BEG1_ [128] GASMA_ALIGNED = { 0xfe, 0xff, 0xff, 0xff, 0xff,
                                                0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfc,
                                                0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
                                                0xff, 0xff, 0xff, 0xf8, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
@@ -19,7 +19,7 @@ uint8_t __MASK_SSE_BEG1_ [128] __aligned = { 0xfe, 0xff, 0xff, 0xff, 0xff,
                                                0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
                                                0xff, 0xff, 0xff };
 
-uint8_t __MASK_SSE_BEG11_ [128] __aligned = { 0xfc, 0xff, 0xff, 0xff, 0xff,
+uint8_t __MASK_SSE_BEG11_ [128] GASMA_ALIGNED = { 0xfc, 0xff, 0xff, 0xff, 0xff,
                                                 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xf0,
                                                 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
                                                 0xff, 0xff, 0xff, 0xc0, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
@@ -236,13 +236,13 @@ uint8_t __MASK_SSE_END11_ [SSE_BIT_LENGTH * SSE_BYTE_NUM / BASE_SIZE11] = {
         0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x0f,
         0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3f, };
 
-uint8_t __MASK_0F_[16] __aligned = { 0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf,
+uint8_t __MASK_0F_[16] GASMA_ALIGNED = { 0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf,
                                        0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf };
 
-uint8_t __MASK_7F_[16] __aligned = { 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f,
+uint8_t __MASK_7F_[16] GASMA_ALIGNED = { 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f,
                                        0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f };
 
-uint8_t __MASK_0TO1_[16] __aligned = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x07,
+uint8_t __MASK_0TO1_[16] GASMA_ALIGNED = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x07,
                                          0x06, 0x07, 0x08, 0x0f, 0x0e, 0x0f, 0x0c, 0x0f, 0x0e, 0x0f };
 
 uint8_t* MASK_SSE_END1 = __MASK_SSE_END1_;
@@ -7,8 +7,9 @@
 #include <boost/preprocessor/arithmetic.hpp>
 #include <boost/preprocessor/punctuation/comma_if.hpp>
 
-#ifndef __aligned
-#define __aligned __attribute__((aligned(16)))
+// not named __aligned, which the standard library uses as an identifier
+#ifndef GASMA_ALIGNED
+#define GASMA_ALIGNED __attribute__((aligned(16)))
 #endif
 
 #define SSE_BIT_LENGTH		128
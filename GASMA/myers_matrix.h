@@ -0,0 +1,300 @@
+#ifndef GASMA_MYERS_MATRIX_H
+#define GASMA_MYERS_MATRIX_H
+
+#include "utils.h"
+#include <climits>
+#include <string>
+#include <vector>
+
+/**
+ * Exact edit distance (Levenshtein) with the bit-parallel algorithm of Myers, in the
+ * formulation of Hyyrö (https://doi.org/10.1016/S0304-3975(00)00332-6).
+ * The whole read is kept in one bit-vector, so each column of the DP matrix is computed
+ * with a constant number of vector operations, and the matrix is stored as its vertical
+ * deltas (Pv: +1, Mv: -1) if a traceback is needed.
+ * @tparam T `int_128bit` (SSE), `int_256bit` (AVX2) or `int_512bit` (AVX-512), representing
+ * the type to store one column of the matrix in bits. Reads longer than the width of T are truncated.
+ */
+template <typename T>
+class myers_matrix {
+private:
+    // number of bits in T, i.e. the longest read that fits into a column
+    static constexpr int W = T::width;
+
+protected:
+    // length of the read (m) and the reference (n)
+    int m, n;
+
+    // the read and the reference
+    char A[W];
+    std::string B;
+
+    // alignment type, either GLOBAL or SEMI_GLOBAL (free gaps at both ends of the reference)
+    alignment_type_t alignment_type;
+
+    // whether run() stores the columns needed to produce the CIGAR string
+    bool traceback;
+
+    // match vectors of A, C, G, T and of any other character (all zeros)
+    T Peq[5];
+
+    // the lowest m bits set
+    T read_mask;
+
+    // vertical deltas of each column of the matrix, only filled when traceback is enabled
+    std::vector<T> Pv_columns;
+    std::vector<T> Mv_columns;
+
+    // result of the alignment
+    int cost;
+    int ref_begin, ref_end;
+    termination_t termination;
+    std::string CIGAR;
+
+    /**
+     * Index of the match vector for a character.
+     */
+    static int _base_index(char c) {
+        switch (c) {
+            case 'A': case 'a': return 0;
+            case 'C': case 'c': return 1;
+            case 'G': case 'g': return 2;
+            case 'T': case 't': return 3;
+            default: return 4;
+        }
+    }
+
+    /**
+     * Build the match vectors of the read, i.e. bit i of Peq[c] is set if A[i] is the character c.
+     */
+    void _build_match_vectors() {
+        alignas(T) uint8_t bits[5][W / 8] = {};
+        alignas(T) uint8_t mask[W / 8] = {};
+        for (int i = 0; i < m; i++) {
+            int c = _base_index(A[i]);
+            // characters other than A, C, G, T never match, so bits[4] stays zero
+            if (c < 4) {
+                bits[c][i >> 3] |= 1 << (i & 7);
+            }
+            mask[i >> 3] |= 1 << (i & 7);
+        }
+        for (int c = 0; c < 5; c++) {
+            Peq[c] = T(bits[c]);
+        }
+        read_mask = T(mask);
+    }
+
+    /**
+     * Whether A[i] and B[j] match, following the same rule as the match vectors.
+     */
+    bool _is_match(int i, int j) {
+        int c = _base_index(A[i]);
+        return c < 4 && c == _base_index(B[j]);
+    }
+
+    /**
+     * Value of the cell (i, j) of the DP matrix, recovered from the stored vertical deltas.
+     */
+    int _value(int i, int j) {
+        int top = alignment_type == GLOBAL ? j : 0;
+        if (i == 0) {
+            return top;
+        }
+        return top + Pv_columns[j].pop_count_between(0, i) - Mv_columns[j].pop_count_between(0, i);
+    }
+
+    /**
+     * Walk back from (m, ref_end) to the first row and produce the CIGAR string.
+     */
+    void _traceback() {
+        std::string operations;
+        int i = m, j = ref_end, d = cost;
+        while (i > 0 && j > 0) {
+            int diagonal = _value(i - 1, j - 1);
+            if (diagonal == d - 1 || (diagonal == d && _is_match(i - 1, j - 1))) {
+                operations += 'M';
+                i--;
+                j--;
+                d = diagonal;
+            } else if (_value(i - 1, j) == d - 1) {
+                operations += 'I';
+                i--;
+                d--;
+            } else {
+                operations += 'D';
+                j--;
+                d--;
+            }
+        }
+        operations.append(i, 'I');
+        if (alignment_type == GLOBAL) {
+            operations.append(j, 'D');
+            j = 0;
+        }
+        ref_begin = j;
+
+        CIGAR = compress_CIGAR(operations, true);
+    }
+
+public:
+    /**
+     * Constructor of the class that sets the alignment type.
+     * @param _alignment_type the type of alignment, either GLOBAL or SEMI_GLOBAL. Default: GLOBAL.
+     * @param _traceback whether run() also produces the CIGAR string. Default: false.
+     */
+    explicit myers_matrix(alignment_type_t _alignment_type = GLOBAL, bool _traceback = false) {
+        alignment_type = _alignment_type;
+        traceback = _traceback;
+        m = n = 0;
+        cost = 0;
+        ref_begin = ref_end = 0;
+        termination = COMPLETED;
+    }
+
+    /**
+     * Reset the object to get ready for the next alignment.
+     * @param read the read string.
+     * @param read_len length of the read string.
+     * @param ref the reference string.
+     * @param ref_len length of the reference string.
+     */
+    void reset(const char* read, const int read_len, const char* ref, const int ref_len) {
+        m = std::min(W, read_len);
+        n = ref_len;
+        strncpy(A, read, m);
+        B.assign(ref, n);
+        _build_match_vectors();
+        cost = 0;
+        ref_begin = ref_end = 0;
+        termination = COMPLETED;
+        CIGAR.clear();
+    }
+
+    void reset(const char* read, const char* ref) {
+        int read_len = static_cast<int>(strlen(read));
+        int ref_len = static_cast<int>(strlen(ref));
+        reset(read, read_len, ref, ref_len);
+    }
+
+    /**
+     * Compute the edit distance between the read and the reference. Must be called after reset().
+     * @param max_cost stop as soon as the edit distance is known to exceed max_cost. In GLOBAL
+     *                 alignment the check is done after every column, otherwise only at the end.
+     * @return COMPLETED, or COST_EXCEEDED if the edit distance is larger than max_cost.
+     */
+    termination_t run(int max_cost = INT_MAX) {
+        termination = COMPLETED;
+        if (alignment_type == GLOBAL && abs(n - m) > max_cost) {
+            cost = abs(n - m);
+            termination = COST_EXCEEDED;
+            return termination;
+        }
+
+        // column 0: D[i][0] = i
+        T Pv = read_mask;
+        T Mv = read_mask._xor(read_mask);
+        int score = m;
+        int best_score = score, best_column = 0;
+        if (traceback) {
+            Pv_columns.resize(n + 1);
+            Mv_columns.resize(n + 1);
+            Pv_columns[0] = Pv;
+            Mv_columns[0] = Mv;
+        }
+
+        for (int j = 0; j < n; j++) {
+            T Eq = Peq[_base_index(B[j])];
+            T Xv = Eq._or(Mv);
+            T Xh = Eq._and(Pv).add(Pv)._xor(Pv)._or(Eq);
+            T Ph = Mv._or(Xh._or(Pv)._not());
+            T Mh = Pv._and(Xh);
+            if (m > 0) {
+                if (Ph.test_bit(m - 1)) {
+                    score++;
+                } else if (Mh.test_bit(m - 1)) {
+                    score--;
+                }
+            }
+            // the first row increases by one per column in GLOBAL alignment, and stays 0 otherwise
+            Ph = alignment_type == GLOBAL ? Ph.shift_right_one() : Ph.shift_right(1);
+            Mh = Mh.shift_right(1);
+            Pv = Mh._or(Xv._or(Ph)._not());
+            Mv = Ph._and(Xv);
+            if (traceback) {
+                Pv_columns[j + 1] = Pv;
+                Mv_columns[j + 1] = Mv;
+            }
+
+            if (alignment_type == GLOBAL) {
+                // the score can only decrease by one per remaining column
+                if (score - (n - 1 - j) > max_cost) {
+                    cost = score - (n - 1 - j);
+                    termination = COST_EXCEEDED;
+                    return termination;
+                }
+            } else if (score < best_score) {
+                best_score = score;
+                best_column = j + 1;
+            }
+        }
+
+        if (alignment_type == GLOBAL) {
+            cost = score;
+            ref_end = n;
+        } else {
+            cost = best_score;
+            ref_end = best_column;
+        }
+        if (cost > max_cost) {
+            termination = COST_EXCEEDED;
+            return termination;
+        }
+        if (traceback) {
+            _traceback();
+        }
+        return termination;
+    }
+
+    /**
+     * Return the edit distance between the read and the reference. If the last run() stopped
+     * with COST_EXCEEDED, this is a lower bound of the edit distance that exceeds max_cost.
+     * @return total penalty
+     */
+    int get_cost() const {
+        return cost;
+    }
+
+    /**
+     * Return the reason why the last run() stopped.
+     * @return COMPLETED or COST_EXCEEDED.
+     */
+    termination_t get_termination() const {
+        return termination;
+    }
+
+    /**
+     * Get the CIGAR string. Must be called after run() with traceback enabled.
+     * In SEMI_GLOBAL alignment it only covers the reference between get_ref_begin() and get_ref_end().
+     * @return CIGAR string.
+     */
+    const std::string& get_CIGAR() const {
+        return CIGAR;
+    }
+
+    /**
+     * Return the first column of the reference in the alignment. Only set by the traceback.
+     */
+    int get_ref_begin() const {
+        return ref_begin;
+    }
+
+    /**
+     * Return the column after the last column of the reference in the alignment.
+     */
+    int get_ref_end() const {
+        return ref_end;
+    }
+};
+
+
+#endif //GASMA_MYERS_MATRIX_H
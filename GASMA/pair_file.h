@@ -0,0 +1,286 @@
+#ifndef GASMA_PAIR_FILE_H
+#define GASMA_PAIR_FILE_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+/**
+ * Binary file of pre-encoded pairs, about 4 times smaller than the text format and read
+ * without any parsing. All numbers are little-endian.
+ *
+ *     header:  char magic[8] = "GASMAPR\0", uint32 version, uint32 flags, uint64 number of pairs
+ *     pairs:   uint16 read length, uint16 reference length, int32 optimal cost,
+ *              packed read, packed reference
+ *
+ * Sequences are 2-bit packed, 4 bases per byte with the first base in the lowest two bits
+ * (A = 0, C = 1, G = 2, T = 3), which hurdle_matrix::reset_packed() reads directly. Characters
+ * other than A, C, G and T are stored as A. The cost is PAIR_FILE_NO_COST if it is unknown.
+ */
+#define PAIR_FILE_MAGIC "GASMAPR"
+#define PAIR_FILE_VERSION 1
+#define PAIR_FILE_NO_COST INT32_MIN
+
+struct pair_file_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;         // reserved, 0
+    uint64_t num_pairs;
+};
+
+struct pair_file_record {
+    uint16_t read_length;
+    uint16_t ref_length;
+    int32_t cost;
+};
+
+/**
+ * Number of bytes of a packed sequence of `length` bases.
+ */
+inline size_t packed_size(int length) {
+    return (length + 3) / 4;
+}
+
+/**
+ * Pack a string into 2 bits per base.
+ * @param sequence the string.
+ * @param length number of characters.
+ * @param packed the output, packed_size(length) bytes.
+ * @return number of characters other than A, C, G and T, which are stored as A.
+ */
+inline int encode_2bit(const char* sequence, int length, uint8_t* packed) {
+    // code of each character, 4 for the characters other than A, C, G and T
+    static const auto codes = [] {
+        std::array<uint8_t, 256> table{};
+        table.fill(4);
+        table['A'] = table['a'] = 0;
+        table['C'] = table['c'] = 1;
+        table['G'] = table['g'] = 2;
+        table['T'] = table['t'] = 3;
+        return table;
+    }();
+    int unknown = 0;
+    memset(packed, 0, packed_size(length));
+    for (int i = 0; i < length; i++) {
+        uint8_t code = codes[static_cast<uint8_t>(sequence[i])];
+        unknown += code >> 2;
+        packed[i >> 2] |= (code & 3) << ((i & 3) * 2);
+    }
+    return unknown;
+}
+
+/**
+ * Unpack 2-bit bases into characters. The output is not null-terminated.
+ */
+inline void decode_2bit(const uint8_t* packed, int length, char* sequence) {
+    static const char bases[] = "ACGT";
+    for (int i = 0; i < length; i++) {
+        sequence[i] = bases[(packed[i >> 2] >> ((i & 3) * 2)) & 3];
+    }
+}
+
+/**
+ * Writes a pair file one pair at a time. The number of pairs in the header is filled in by close().
+ */
+class pair_file_writer {
+protected:
+    FILE* file;
+    uint64_t num_pairs;
+    std::vector<uint8_t> buffer;
+
+public:
+    explicit pair_file_writer(const char* path) {
+        num_pairs = 0;
+        file = fopen(path, "wb");
+        if (file != nullptr) {
+            pair_file_header header{};
+            memcpy(header.magic, PAIR_FILE_MAGIC, sizeof(PAIR_FILE_MAGIC));
+            header.version = PAIR_FILE_VERSION;
+            fwrite(&header, sizeof(header), 1, file);
+        }
+    }
+
+    pair_file_writer(const pair_file_writer&) = delete;
+    pair_file_writer& operator=(const pair_file_writer&) = delete;
+
+    bool is_open() const {
+        return file != nullptr;
+    }
+
+    /**
+     * Append a pair. Sequences longer than 65535 characters are cut. Does nothing if the
+     * file is not open.
+     * @param cost the optimal cost, or PAIR_FILE_NO_COST if unknown.
+     * @return number of characters other than A, C, G and T in the two strings.
+     */
+    int write(const char* read, int read_length, const char* ref, int ref_length, int32_t cost = PAIR_FILE_NO_COST) {
+        if (!is_open()) {
+            return 0;
+        }
+        pair_file_record record{};
+        record.read_length = static_cast<uint16_t>(std::min(read_length, UINT16_MAX));
+        record.ref_length = static_cast<uint16_t>(std::min(ref_length, UINT16_MAX));
+        record.cost = cost;
+        size_t read_bytes = packed_size(record.read_length);
+        buffer.resize(read_bytes + packed_size(record.ref_length));
+        int unknown = encode_2bit(read, record.read_length, buffer.data());
+        unknown += encode_2bit(ref, record.ref_length, buffer.data() + read_bytes);
+        fwrite(&record, sizeof(record), 1, file);
+        fwrite(buffer.data(), 1, buffer.size(), file);
+        num_pairs++;
+        return unknown;
+    }
+
+    /**
+     * Write the number of pairs into the header and close the file.
+     * @return false if any write failed.
+     */
+    bool close() {
+        if (file == nullptr) {
+            return false;
+        }
+        bool success = fseek(file, offsetof(pair_file_header, num_pairs), SEEK_SET) == 0 &&
+                       fwrite(&num_pairs, sizeof(num_pairs), 1, file) == 1;
+        success = !ferror(file) && success;
+        success = fclose(file) == 0 && success;
+        file = nullptr;
+        return success;
+    }
+
+    ~pair_file_writer() {
+        close();
+    }
+};
+
+/**
+ * Reads a pair file through a read-only memory map. The packed sequences are used in place.
+ */
+class pair_file_reader {
+protected:
+    uint8_t* data;
+    size_t size;
+
+    // offset of the record of each pair
+    std::vector<size_t> offsets;
+
+    // records are not aligned, so they are copied out of the mapping
+    pair_file_record _record(size_t i) const {
+        pair_file_record record{};
+        memcpy(&record, data + offsets[i], sizeof(record));
+        return record;
+    }
+
+    void _unmap() {
+        if (data != nullptr) {
+            munmap(data, size);
+        }
+        data = nullptr;
+        size = 0;
+        offsets.clear();
+    }
+
+public:
+    /**
+     * Map the file and index its pairs. Check is_open() for errors.
+     */
+    explicit pair_file_reader(const char* path) {
+        data = nullptr;
+        size = 0;
+        int file = open(path, O_RDONLY);
+        if (file < 0) {
+            return;
+        }
+        struct stat status{};
+        if (fstat(file, &status) != 0 || (size_t) status.st_size < sizeof(pair_file_header)) {
+            ::close(file);
+            return;
+        }
+        size = status.st_size;
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, file, 0);
+        ::close(file);
+        if (mapping == MAP_FAILED) {
+            size = 0;
+            return;
+        }
+        data = static_cast<uint8_t*>(mapping);
+
+        pair_file_header header{};
+        memcpy(&header, data, sizeof(header));
+        // every pair takes at least one record, so a larger count is a corrupt or truncated file
+        if (memcmp(header.magic, PAIR_FILE_MAGIC, sizeof(PAIR_FILE_MAGIC)) != 0 || header.version != PAIR_FILE_VERSION ||
+            header.num_pairs > (size - sizeof(header)) / sizeof(pair_file_record)) {
+            _unmap();
+            return;
+        }
+        offsets.reserve(header.num_pairs);
+        size_t offset = sizeof(header);
+        for (uint64_t i = 0; i < header.num_pairs; i++) {
+            if (offset + sizeof(pair_file_record) > size) {
+                _unmap();
+                return;
+            }
+            pair_file_record record{};
+            memcpy(&record, data + offset, sizeof(record));
+            offsets.push_back(offset);
+            offset += sizeof(record) + packed_size(record.read_length) + packed_size(record.ref_length);
+            if (offset > size) {
+                _unmap();
+                return;
+            }
+        }
+    }
+
+    pair_file_reader(const pair_file_reader&) = delete;
+    pair_file_reader& operator=(const pair_file_reader&) = delete;
+
+    /**
+     * Check whether the file was mapped and is a valid pair file.
+     */
+    bool is_open() const {
+        return data != nullptr;
+    }
+
+    size_t num_pairs() const {
+        return offsets.size();
+    }
+
+    int read_length(size_t i) const {
+        return _record(i).read_length;
+    }
+
+    int ref_length(size_t i) const {
+        return _record(i).ref_length;
+    }
+
+    /**
+     * Return the optimal cost of pair i, or PAIR_FILE_NO_COST if it is unknown.
+     */
+    int cost(size_t i) const {
+        return _record(i).cost;
+    }
+
+    const uint8_t* read_packed(size_t i) const {
+        return data + offsets[i] + sizeof(pair_file_record);
+    }
+
+    const uint8_t* ref_packed(size_t i) const {
+        return read_packed(i) + packed_size(read_length(i));
+    }
+
+    ~pair_file_reader() {
+        _unmap();
+    }
+};
+
+
+#endif //GASMA_PAIR_FILE_H
@@ -0,0 +1,61 @@
+/**
+ * Test batch_aligner against hurdle_matrix on the same pairs: the results must not depend on
+ * the number of threads, the chunk size or the worker that aligned a pair.
+ */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "../batch_aligner.h"
+#include "test_utils.h"
+
+#define TEST_NUM 5000
+#define READ_LENGTH 100
+#define ERROR_RATE 0.08
+
+/**
+ * Align the same pairs with batch_aligner and serially, and compare the results.
+ */
+static int test_batch(int num_threads, int chunk_size, alignment_type_t alignment_type, int x, int o, int e) {
+    test_checker checker;
+    pair_generator generator(40);
+    std::vector<std::string> reads(TEST_NUM), refs(TEST_NUM);
+    std::vector<alignment_pair> pairs(TEST_NUM);
+    for (int t = 0; t < TEST_NUM; t++) {
+        generator.next(reads[t], refs[t], READ_LENGTH, ERROR_RATE);
+        pairs[t] = {reads[t], refs[t]};
+    }
+    batch_aligner<int_128bit> aligner(num_threads, 3, alignment_type, x, o, e, chunk_size);
+    std::vector<alignment_result> results(TEST_NUM);
+    aligner.align_batch(pairs, results);
+
+    // for_each() reaches every item exactly once
+    std::vector<int> visits(TEST_NUM, 0);
+    aligner.for_each(TEST_NUM, [&](hurdle_matrix<int_128bit>&, int i) { visits[i]++; });
+
+    hurdle_matrix<int_128bit> matrix(alignment_type, x, o, e);
+    for (int t = 0; t < TEST_NUM; t++) {
+        const std::string& read = reads[t];
+        const std::string& ref = refs[t];
+        matrix.reset(read.c_str(), (int) read.size(), ref.c_str(), (int) ref.size(), 3);
+        matrix.run();
+        checker.check(results[t].cost == matrix.get_cost(), "batch cost", read, ref, results[t].cost, matrix.get_cost());
+        checker.check(results[t].termination == matrix.get_termination(), "batch termination", read, ref,
+                      results[t].termination, matrix.get_termination());
+        checker.check(results[t].CIGAR == matrix.get_CIGAR(), "batch CIGAR", read, ref, results[t].cost, matrix.get_cost());
+        checker.check(visits[t] == 1, "for_each visits", read, ref, visits[t], 1);
+    }
+    char name[96];
+    snprintf(name, sizeof(name), "batch_aligner %s (%d, %d, %d), %d threads, chunks of %d",
+             alignment_type == GLOBAL ? "GLOBAL" : "SEMI_GLOBAL", x, o, e, num_threads, chunk_size);
+    return checker.report(name);
+}
+
+int main() {
+    int failed = 0;
+    failed |= test_batch(1, BATCH_CHUNK_SIZE, GLOBAL, 1, 1, 1);
+    failed |= test_batch(4, 7, GLOBAL, 1, 1, 1);
+    failed |= test_batch(4, 7, GLOBAL, 4, 6, 1);
+    failed |= test_batch(3, 1, SEMI_GLOBAL, 1, 1, 1);
+    return failed;
+}
@@ -0,0 +1,77 @@
+/**
+ * Test the argument checks of the C interface (capi/gasma.h): no call may write outside of
+ * the buffers it is given.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "../capi/gasma.h"
+#include "test_utils.h"
+
+#define SENTINEL 0xdeadbeefu
+#define BUFFER_SIZE 8
+
+/**
+ * Return whether the entries of the buffer from `begin` on are untouched.
+ */
+static bool untouched(const uint32_t* buffer, int begin) {
+    for (int i = begin; i < BUFFER_SIZE; i++) {
+        if (buffer[i] != SENTINEL) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * gasma_align() must reject a CIGAR buffer without capacity, and stop at the capacity of a
+ * buffer that is too small.
+ */
+static int test_cigar_capacity() {
+    test_checker checker;
+    gasma_aligner* aligner = gasma_create(nullptr);
+    // one deletion in the middle: three CIGAR operations
+    std::string read = "ACGTACGTACGTACGT", ref = "ACGTACGTTACGTACGT";
+    uint32_t buffer[BUFFER_SIZE];
+    gasma_result result;
+
+    for (int capacity : {-1, 0}) {
+        std::fill(buffer, buffer + BUFFER_SIZE, SENTINEL);
+        int32_t status = gasma_align(aligner, read.c_str(), (int32_t) read.size(), ref.c_str(), (int32_t) ref.size(),
+                                     buffer, capacity, &result);
+        checker.check(status == GASMA_ERROR_INVALID_ARGUMENT, "capacity <= 0 status", read, ref, status,
+                      GASMA_ERROR_INVALID_ARGUMENT);
+        checker.check(result.status == status, "capacity <= 0 result status", read, ref, result.status, status);
+        checker.check(untouched(buffer, 0), "capacity <= 0 buffer", read, ref, capacity, 0);
+    }
+
+    std::fill(buffer, buffer + BUFFER_SIZE, SENTINEL);
+    int32_t status = gasma_align(aligner, read.c_str(), (int32_t) read.size(), ref.c_str(), (int32_t) ref.size(),
+                                 buffer, 1, &result);
+    checker.check(status == GASMA_ERROR_BUFFER_TOO_SMALL, "small buffer status", read, ref, status,
+                  GASMA_ERROR_BUFFER_TOO_SMALL);
+    checker.check(untouched(buffer, 1), "small buffer bound", read, ref, 1, 0);
+
+    std::fill(buffer, buffer + BUFFER_SIZE, SENTINEL);
+    status = gasma_align(aligner, read.c_str(), (int32_t) read.size(), ref.c_str(), (int32_t) ref.size(),
+                         buffer, BUFFER_SIZE, &result);
+    checker.check(status == GASMA_OK, "buffer status", read, ref, status, GASMA_OK);
+    checker.check(result.num_cigar_ops == 3, "buffer operations", read, ref, result.num_cigar_ops, 3);
+    checker.check(untouched(buffer, result.num_cigar_ops), "buffer bound", read, ref, result.num_cigar_ops, 3);
+
+    // the batch entry points reject a stride without capacity in the same way
+    gasma_pair pair = {read.c_str(), (int32_t) read.size(), ref.c_str(), (int32_t) ref.size()};
+    std::fill(buffer, buffer + BUFFER_SIZE, SENTINEL);
+    status = gasma_align_batch(aligner, &pair, 1, buffer, -1, &result);
+    checker.check(status == GASMA_ERROR_INVALID_ARGUMENT, "batch stride status", read, ref, status,
+                  GASMA_ERROR_INVALID_ARGUMENT);
+    checker.check(untouched(buffer, 0), "batch stride buffer", read, ref, -1, 0);
+
+    gasma_destroy(aligner);
+    return checker.report("C interface CIGAR capacity");
+}
+
+int main() {
+    return test_cigar_capacity();
+}
@@ -0,0 +1,141 @@
+/**
+ * Test the exact engines and the hybrid aligner on random pairs against the reference DP of
+ * test_utils.h: costs must be optimal where the engine is exact, and always be the cost of the
+ * returned CIGAR string.
+ */
+
+#include <climits>
+#include <cstdio>
+#include <string>
+#include "../hybrid_aligner.h"
+#include "test_utils.h"
+
+#define TEST_NUM 5000
+#define READ_LENGTH 100
+#define ERROR_RATE 0.08
+
+/**
+ * Insert random bases at both ends of the reference, so that the read is somewhere inside it.
+ */
+static void pad_reference(pair_generator& generator, std::string& ref) {
+    for (int c = generator.uniform(0, 12); c > 0; c--) {
+        ref.insert(ref.begin(), generator.base());
+    }
+    for (int c = generator.uniform(0, 12); c > 0; c--) {
+        ref += generator.base();
+    }
+    ref.resize(std::min((int) ref.size(), MAX_LENGTH));
+}
+
+/**
+ * myers_matrix must find the edit distance, a CIGAR string of that cost over the reference
+ * between get_ref_begin() and get_ref_end(), and stop as soon as max_cost is exceeded.
+ */
+static int test_myers(alignment_type_t alignment_type) {
+    test_checker checker;
+    pair_generator generator(28);
+    myers_matrix<int_128bit> matrix(alignment_type, true);
+    std::string read, ref;
+    bool global = alignment_type == GLOBAL;
+    for (int t = 0; t < TEST_NUM; t++) {
+        generator.next(read, ref, READ_LENGTH, 2 * ERROR_RATE);
+        if (!global) {
+            pad_reference(generator, ref);
+        }
+        int optimal = global ? reference_cost(read, ref) : reference_semi_global_cost(read, ref);
+        matrix.reset(read.c_str(), (int) read.size(), ref.c_str(), (int) ref.size());
+        checker.check(matrix.run() == COMPLETED, "myers termination", read, ref, matrix.get_termination(), COMPLETED);
+        checker.check(matrix.get_cost() == optimal, "myers cost", read, ref, matrix.get_cost(), optimal);
+        int begin = matrix.get_ref_begin(), end = matrix.get_ref_end();
+        int path_cost = CIGAR_cost(matrix.get_CIGAR(), read, ref.substr(begin, end - begin));
+        checker.check(path_cost == optimal, "myers CIGAR cost", read, ref, path_cost, optimal);
+
+        if (optimal > 0) {
+            matrix.reset(read.c_str(), (int) read.size(), ref.c_str(), (int) ref.size());
+            checker.check(matrix.run(optimal - 1) == COST_EXCEEDED, "myers max_cost termination", read, ref,
+                          matrix.get_termination(), COST_EXCEEDED);
+            // a lower bound above optimal - 1 is the edit distance itself
+            checker.check(matrix.get_cost() == optimal, "myers max_cost cost", read, ref, matrix.get_cost(), optimal);
+        }
+    }
+    return checker.report(global ? "myers_matrix GLOBAL" : "myers_matrix SEMI_GLOBAL");
+}
+
+/**
+ * banded_dp must find the optimal affine cost and a CIGAR string of that cost whenever the
+ * budget allows it, and report COST_EXCEEDED with max_cost + 1 otherwise.
+ */
+static int test_banded_dp(int x, int o, int e) {
+    test_checker checker;
+    pair_generator generator(30);
+    banded_dp dp(x, o, e);
+    hurdle_matrix<int_128bit> matrix(GLOBAL, x, o, e);
+    std::string read, ref;
+    for (int t = 0; t < TEST_NUM; t++) {
+        generator.next(read, ref, READ_LENGTH, ERROR_RATE);
+        int optimal = reference_cost(read, ref, x, o, e);
+        matrix.reset(read.c_str(), (int) read.size(), ref.c_str(), (int) ref.size(), 3);
+        matrix.run();
+        // no budget, the greedy cost as budget, and the tightest budget that still succeeds
+        for (int budget : {INT_MAX / 2, matrix.get_cost(), optimal}) {
+            dp.reset(read.c_str(), (int) read.size(), ref.c_str(), (int) ref.size());
+            checker.check(dp.run(budget) == COMPLETED, "banded_dp termination", read, ref, dp.get_termination(), COMPLETED);
+            checker.check(dp.get_cost() == optimal, "banded_dp cost", read, ref, dp.get_cost(), optimal);
+            int path_cost = CIGAR_cost(dp.get_CIGAR(), read, ref, x, o, e);
+            checker.check(path_cost == optimal, "banded_dp CIGAR cost", read, ref, path_cost, optimal);
+        }
+        if (optimal > 0) {
+            dp.reset(read.c_str(), (int) read.size(), ref.c_str(), (int) ref.size());
+            checker.check(dp.run(optimal - 1) == COST_EXCEEDED, "banded_dp max_cost termination", read, ref,
+                          dp.get_termination(), COST_EXCEEDED);
+            checker.check(dp.get_cost() == optimal, "banded_dp max_cost cost", read, ref, dp.get_cost(), optimal);
+        }
+    }
+    return checker.report(x == 1 && o == 1 && e == 1 ? "banded_dp" : "banded_dp (affine)");
+}
+
+/**
+ * hybrid_aligner must return the cost of its CIGAR string, optimal after a fallback, and the
+ * same alignment extent from both engines.
+ */
+static int test_hybrid(alignment_type_t alignment_type) {
+    test_checker checker;
+    pair_generator generator(32);
+    hybrid_aligner<int_128bit> aligner(3, alignment_type);
+    std::string read, ref;
+    bool global = alignment_type == GLOBAL;
+    for (int t = 0; t < TEST_NUM; t++) {
+        generator.next(read, ref, READ_LENGTH, ERROR_RATE);
+        if (!global) {
+            pad_reference(generator, ref);
+        }
+        int optimal = global ? reference_cost(read, ref) : reference_semi_global_cost(read, ref);
+        int cost = aligner.align(read.c_str(), (int) read.size(), ref.c_str(), (int) ref.size());
+        int path_cost = CIGAR_cost(aligner.get_CIGAR(), read, ref, 1, 1, 1, !global);
+        checker.check(path_cost == cost, "hybrid CIGAR cost", read, ref, path_cost, cost);
+        checker.check(cost >= optimal, "hybrid cost", read, ref, cost, optimal);
+        if (aligner.get_used_fallback() || aligner.get_certified()) {
+            checker.check(cost == optimal, "hybrid exact cost", read, ref, cost, optimal);
+        }
+    }
+
+    // strings longer than MAX_LENGTH are truncated by both engines
+    generator.next(read, ref, 2 * MAX_LENGTH, ERROR_RATE, 2 * MAX_LENGTH);
+    aligner.set_max_trusted_leaps(-1);
+    int cost = aligner.align(read.c_str(), (int) read.size(), ref.c_str(), (int) ref.size());
+    std::string read_prefix = read.substr(0, MAX_LENGTH), ref_prefix = ref.substr(0, MAX_LENGTH);
+    int path_cost = CIGAR_cost(aligner.get_CIGAR(), read_prefix, ref_prefix, 1, 1, 1, !global);
+    checker.check(path_cost == cost, "hybrid truncated CIGAR cost", read_prefix, ref_prefix, path_cost, cost);
+    return checker.report(global ? "hybrid_aligner GLOBAL" : "hybrid_aligner SEMI_GLOBAL");
+}
+
+int main() {
+    int failed = 0;
+    failed |= test_myers(GLOBAL);
+    failed |= test_myers(SEMI_GLOBAL);
+    failed |= test_banded_dp(1, 1, 1);
+    failed |= test_banded_dp(4, 6, 1);
+    failed |= test_hybrid(GLOBAL);
+    failed |= test_hybrid(SEMI_GLOBAL);
+    return failed;
+}
@@ -0,0 +1,328 @@
+/**
+ * Test the run modes of hurdle_matrix on random pairs against the Gotoh DP of test_utils.h:
+ * every cost must be reachable by its CIGAR string and never below the optimal cost.
+ */
+
+#include <climits>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../hurdle_matrix.h"
+#include "test_utils.h"
+
+#define TEST_NUM 5000
+#define READ_LENGTH 100
+#define ERROR_RATE 0.08
+
+typedef hurdle_matrix<int_128bit> matrix_t;
+
+static void reset(matrix_t& matrix, const std::string& read, const std::string& ref, int k) {
+    matrix.reset(read.c_str(), (int) read.size(), ref.c_str(), (int) ref.size(), k);
+}
+
+/**
+ * Check that the result of the last run is a valid alignment whose cost is not below the optimum.
+ */
+static void check_result(test_checker& checker, const char* what, matrix_t& matrix, const std::string& read,
+                         const std::string& ref, int optimal, int x = 1, int o = 1, int e = 1) {
+    int cost = matrix.get_cost();
+    checker.check(CIGAR_cost(matrix.get_CIGAR(), read, ref, x, o, e) == cost, what, read, ref,
+                  CIGAR_cost(matrix.get_CIGAR(), read, ref, x, o, e), cost);
+    checker.check(cost >= optimal, what, read, ref, cost, optimal);
+}
+
+/**
+ * A run within budget must complete, and a run over budget must stop with the right reason,
+ * after at most the steps and with at most the cost of the complete run.
+ */
+static int test_budgets() {
+    test_checker checker;
+    pair_generator generator(26);
+    matrix_t matrix;
+    std::string read, ref;
+    for (int t = 0; t < TEST_NUM; t++) {
+        generator.next(read, ref, READ_LENGTH, ERROR_RATE);
+        reset(matrix, read, ref, 3);
+        matrix.run();
+        int cost = matrix.get_cost(), steps = matrix.get_num_steps();
+
+        reset(matrix, read, ref, 3);
+        checker.check(matrix.run(cost, steps) == COMPLETED, "run within budget", read, ref,
+                      matrix.get_termination(), COMPLETED);
+        checker.check(matrix.get_cost() == cost, "run within budget cost", read, ref, matrix.get_cost(), cost);
+        if (cost > 0) {
+            reset(matrix, read, ref, 3);
+            checker.check(matrix.run(cost - 1) == COST_EXCEEDED, "max_cost termination", read, ref,
+                          matrix.get_termination(), COST_EXCEEDED);
+            checker.check(matrix.get_cost() == cost, "max_cost cost", read, ref, matrix.get_cost(), cost);
+            checker.check(matrix.get_num_steps() <= steps, "max_cost steps", read, ref, matrix.get_num_steps(), steps);
+        }
+        if (steps > 1) {
+            reset(matrix, read, ref, 3);
+            checker.check(matrix.run(INT_MAX, steps - 1) == STEPS_EXCEEDED, "max_steps termination", read, ref,
+                          matrix.get_termination(), STEPS_EXCEEDED);
+            checker.check(matrix.get_num_steps() == steps - 1, "max_steps steps", read, ref,
+                          matrix.get_num_steps(), steps - 1);
+            checker.check(matrix.get_cost() <= cost, "max_steps cost", read, ref, matrix.get_cost(), cost);
+        }
+    }
+    return checker.report("run budgets");
+}
+
+/**
+ * run_adaptive() must leave the object as a plain run() with the returned band would.
+ */
+static int test_adaptive() {
+    test_checker checker;
+    pair_generator generator(27);
+    matrix_t matrix, plain;
+    std::string read, ref;
+    for (int t = 0; t < TEST_NUM; t++) {
+        generator.next(read, ref, READ_LENGTH, 2 * ERROR_RATE);
+        int optimal = reference_cost(read, ref);
+        reset(matrix, read, ref, 0);
+        matrix.run_adaptive(1, 24);
+        check_result(checker, "run_adaptive cost", matrix, read, ref, optimal);
+
+        reset(plain, read, ref, matrix.get_band());
+        plain.run();
+        checker.check(plain.get_cost() == matrix.get_cost(), "run_adaptive vs run", read, ref,
+                      matrix.get_cost(), plain.get_cost());
+        checker.check(plain.hits_band_edge() == matrix.hits_band_edge(), "run_adaptive band edge", read, ref,
+                      matrix.hits_band_edge(), plain.hits_band_edge());
+        checker.check(plain.get_lower_bound() == matrix.get_lower_bound(), "run_adaptive lower bound", read, ref,
+                      matrix.get_lower_bound(), plain.get_lower_bound());
+        checker.check(plain.get_num_steps() == matrix.get_num_steps(), "run_adaptive steps", read, ref,
+                      matrix.get_num_steps(), plain.get_num_steps());
+    }
+    return checker.report("run_adaptive");
+}
+
+/**
+ * run_beam() must never be worse than run().
+ */
+static int test_beam() {
+    test_checker checker;
+    pair_generator generator(29);
+    matrix_t matrix;
+    std::string read, ref;
+    for (int t = 0; t < TEST_NUM; t++) {
+        generator.next(read, ref, READ_LENGTH, ERROR_RATE);
+        int optimal = reference_cost(read, ref);
+        reset(matrix, read, ref, 3);
+        matrix.run();
+        int greedy_cost = matrix.get_cost();
+        for (int width : {2, 4, 8}) {
+            reset(matrix, read, ref, 3);
+            matrix.run_beam(width);
+            check_result(checker, "run_beam cost", matrix, read, ref, optimal);
+            checker.check(matrix.get_cost() <= greedy_cost, "run_beam vs run", read, ref, matrix.get_cost(), greedy_cost);
+        }
+    }
+    return checker.report("run_beam");
+}
+
+/**
+ * run_bidirectional() must never be worse than run(), and its cost must be that of its CIGAR
+ * string, which is reversed back for the right-to-left pass. If the forward pass is kept, the
+ * object must describe it as a plain run() would.
+ */
+static int test_bidirectional(int x, int o, int e) {
+    test_checker checker;
+    pair_generator generator(31);
+    matrix_t matrix(GLOBAL, x, o, e), plain(GLOBAL, x, o, e);
+    std::string read, ref;
+    for (int t = 0; t < TEST_NUM; t++) {
+        generator.next(read, ref, READ_LENGTH, ERROR_RATE);
+        int optimal = reference_cost(read, ref, x, o, e);
+        reset(plain, read, ref, 3);
+        plain.run();
+        int greedy_cost = plain.get_cost();
+        reset(matrix, read, ref, 3);
+        matrix.run_bidirectional();
+        check_result(checker, "run_bidirectional cost", matrix, read, ref, optimal, x, o, e);
+        checker.check(matrix.get_cost() <= greedy_cost, "run_bidirectional vs run", read, ref,
+                      matrix.get_cost(), greedy_cost);
+        if (matrix.get_CIGAR() != plain.get_CIGAR()) {
+            continue;
+        }
+        // the forward pass was kept
+        checker.check(matrix.get_lower_bound() == plain.get_lower_bound(), "run_bidirectional lower bound", read, ref,
+                      matrix.get_lower_bound(), plain.get_lower_bound());
+        checker.check(matrix.is_certified() == plain.is_certified(), "run_bidirectional certified", read, ref,
+                      matrix.is_certified(), plain.is_certified());
+        checker.check(matrix.hits_band_edge() == plain.hits_band_edge(), "run_bidirectional band edge", read, ref,
+                      matrix.hits_band_edge(), plain.hits_band_edge());
+        checker.check(matrix.get_num_steps() == plain.get_num_steps(), "run_bidirectional steps", read, ref,
+                      matrix.get_num_steps(), plain.get_num_steps());
+    }
+    return checker.report(x == 1 && o == 1 && e == 1 ? "run_bidirectional" : "run_bidirectional (affine)");
+}
+
+/**
+ * The lower bound must never exceed the optimal cost, so a certified run must be optimal.
+ */
+static int test_certificate(int x, int o, int e) {
+    test_checker checker;
+    pair_generator generator(33);
+    matrix_t matrix(GLOBAL, x, o, e);
+    std::string read, ref;
+    int certified = 0;
+    for (int t = 0; t < TEST_NUM; t++) {
+        generator.next(read, ref, READ_LENGTH, ERROR_RATE);
+        int optimal = reference_cost(read, ref, x, o, e);
+        reset(matrix, read, ref, 3);
+        matrix.run();
+        int bound = matrix.get_lower_bound();
+        checker.check(bound <= optimal, "lower bound", read, ref, bound, optimal);
+        if (matrix.is_certified()) {
+            certified++;
+            checker.check(matrix.get_cost() == optimal, "certified cost", read, ref, matrix.get_cost(), optimal);
+        }
+    }
+    // with unit costs, the bound must prove some of the pairs with few errors; with a cheap
+    // gap extension it counts every character at min(x, o, e) and is rarely reached
+    if (x == 1 && o == 1 && e == 1) {
+        checker.check(certified > 0, "certified runs", "", "", certified, 1);
+    }
+    return checker.report(x == 1 && o == 1 && e == 1 ? "lower bound" : "lower bound (affine)");
+}
+
+/**
+ * Expected SAM NM and MD tags of an extended CIGAR string. If `free_end_deletions` is set,
+ * deletions at both ends of the path are not counted.
+ */
+static void expected_tags(const std::string& extended_CIGAR, const std::string& ref, bool free_end_deletions,
+                          int& NM, std::string& MD) {
+    std::vector<std::pair<int, char>> runs;
+    int length = 0;
+    for (char c : extended_CIGAR) {
+        if (isdigit(c)) {
+            length = length * 10 + (c - '0');
+        } else {
+            runs.emplace_back(length, c);
+            length = 0;
+        }
+    }
+    NM = 0;
+    MD.clear();
+    int matches = 0;
+    size_t j = 0;
+    for (size_t r = 0; r < runs.size(); r++) {
+        auto [run_length, op] = runs[r];
+        bool free = free_end_deletions && (r == 0 || r + 1 == runs.size());
+        if (op == '=') {
+            matches += run_length;
+        } else if (op == 'X') {
+            for (int c = 0; c < run_length; c++) {
+                MD += std::to_string(matches) + ref[j + c];
+                matches = 0;
+            }
+            NM += run_length;
+        } else if (op == 'I') {
+            NM += run_length;
+        } else if (!free) {
+            MD += std::to_string(matches) + '^' + ref.substr(j, run_length);
+            matches = 0;
+            NM += run_length;
+        }
+        if (op != 'I') {
+            j += run_length;
+        }
+    }
+    MD += std::to_string(matches);
+}
+
+/**
+ * resolve_mismatches() must produce an =/X CIGAR string of the same path, and NM and MD tags
+ * that agree with it.
+ */
+static int test_resolve_mismatches(alignment_type_t alignment_type) {
+    test_checker checker;
+    pair_generator generator(34);
+    matrix_t matrix(alignment_type);
+    std::string read, ref;
+    bool global = alignment_type == GLOBAL;
+    for (int t = 0; t < TEST_NUM; t++) {
+        generator.next(read, ref, READ_LENGTH, ERROR_RATE);
+        reset(matrix, read, ref, 3);
+        matrix.run();
+        matrix.resolve_mismatches();
+        const std::string& extended_CIGAR = matrix.get_extended_CIGAR();
+        int path_cost = CIGAR_cost(matrix.get_CIGAR(), read, ref, 1, 1, 1, !global);
+        int extended_cost = CIGAR_cost(extended_CIGAR, read, ref, 1, 1, 1, !global);
+        checker.check(extended_cost >= 0 && extended_cost == path_cost, "extended CIGAR", read, ref,
+                      extended_cost, path_cost);
+        checker.check(extended_CIGAR.find('M') == std::string::npos, "extended CIGAR without M", read, ref, 0, 0);
+
+        int NM;
+        std::string MD;
+        expected_tags(extended_CIGAR, ref, !global, NM, MD);
+        checker.check(matrix.get_NM() == NM, "NM", read, ref, matrix.get_NM(), NM);
+        checker.check(matrix.get_MD() == MD, "MD", read, ref, (int) matrix.get_MD().size(), (int) MD.size());
+    }
+    return checker.report(global ? "resolve_mismatches GLOBAL" : "resolve_mismatches SEMI_GLOBAL");
+}
+
+/**
+ * polish() must never increase the cost, and its cost must be that of the spliced CIGAR string,
+ * also with affine penalties where neighbouring windows may merge their gaps.
+ */
+static int test_polish(int x, int o, int e) {
+    test_checker checker;
+    pair_generator generator(35);
+    matrix_t matrix(GLOBAL, x, o, e);
+    std::string read, ref;
+    for (int t = 0; t < TEST_NUM; t++) {
+        generator.next(read, ref, READ_LENGTH, ERROR_RATE);
+        int optimal = reference_cost(read, ref, x, o, e);
+        reset(matrix, read, ref, 3);
+        matrix.run();
+        check_result(checker, "run cost", matrix, read, ref, optimal, x, o, e);
+        int greedy_cost = matrix.get_cost();
+        matrix.polish();
+        check_result(checker, "polish cost", matrix, read, ref, optimal, x, o, e);
+        checker.check(matrix.get_cost() <= greedy_cost, "polish vs run", read, ref, matrix.get_cost(), greedy_cost);
+    }
+    return checker.report(x == 1 && o == 1 && e == 1 ? "polish" : "polish (affine)");
+}
+
+/**
+ * hurdle_matrix<int_256bit> must find the same path as hurdle_matrix<int_128bit>, as both align
+ * at most MAX_LENGTH characters.
+ */
+static int test_wide() {
+    test_checker checker;
+    pair_generator generator(37);
+    matrix_t matrix;
+    hurdle_matrix<int_256bit> wide;
+    std::string read, ref;
+    for (int t = 0; t < TEST_NUM; t++) {
+        generator.next(read, ref, READ_LENGTH, ERROR_RATE);
+        reset(matrix, read, ref, 3);
+        matrix.run();
+        wide.reset(read.c_str(), (int) read.size(), ref.c_str(), (int) ref.size(), 3);
+        wide.run();
+        checker.check(wide.get_CIGAR() == matrix.get_CIGAR(), "int_256bit CIGAR", read, ref, wide.get_cost(),
+                      matrix.get_cost());
+    }
+    return checker.report("int_256bit");
+}
+
+int main() {
+    int failed = 0;
+    failed |= test_budgets();
+    failed |= test_adaptive();
+    failed |= test_beam();
+    failed |= test_bidirectional(1, 1, 1);
+    failed |= test_bidirectional(4, 6, 1);
+    failed |= test_certificate(1, 1, 1);
+    failed |= test_certificate(4, 6, 1);
+    failed |= test_resolve_mismatches(GLOBAL);
+    failed |= test_resolve_mismatches(SEMI_GLOBAL);
+    failed |= test_polish(1, 1, 1);
+    failed |= test_polish(4, 6, 1);
+    failed |= test_wide();
+    return failed;
+}
@@ -0,0 +1,196 @@
+#ifndef GASMA_TEST_UTILS_H
+#define GASMA_TEST_UTILS_H
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Helpers shared by the tests of the alignment engines: a random pair generator, a full
+ * Gotoh DP as the reference, and the cost of a CIGAR string computed from the strings.
+ * A gap of length L costs o + e * (L - 1), as in switch_lane_penalty().
+ */
+
+#define TEST_INF (INT_MAX / 4)
+
+/**
+ * Generate random pairs of DNA strings, where the reference is the read with random
+ * substitutions, insertions and deletions.
+ */
+class pair_generator {
+    std::mt19937_64 rng;
+
+public:
+    explicit pair_generator(uint64_t seed) : rng(seed) {}
+
+    int uniform(int low, int high) {
+        return std::uniform_int_distribution<int>(low, high)(rng);
+    }
+
+    char base() {
+        return "ACGT"[uniform(0, 3)];
+    }
+
+    char substitute(char c) {
+        const char* bases = "ACGT";
+        int index = static_cast<int>(std::find(bases, bases + 4, c) - bases);
+        return bases[(index + uniform(1, 3)) % 4];
+    }
+
+    /**
+     * Generate a pair.
+     * @param read_length length of the read.
+     * @param error_rate probability of an edit at each position.
+     * @param max_length longest reference to return, longer ones are truncated.
+     */
+    void next(std::string& read, std::string& ref, int read_length, double error_rate, int max_length = 128) {
+        read.clear();
+        ref.clear();
+        for (int i = 0; i < read_length; i++) {
+            read += base();
+        }
+        std::uniform_real_distribution<double> real(0, 1);
+        for (int i = 0; i < read_length; i++) {
+            if (real(rng) >= error_rate) {
+                ref += read[i];
+                continue;
+            }
+            switch (uniform(0, 2)) {
+                case 0: ref += substitute(read[i]); break;
+                case 1: break;
+                default: ref += read[i]; ref += base(); break;
+            }
+        }
+        if ((int) ref.size() > max_length) {
+            ref.resize(max_length);
+        }
+    }
+};
+
+/**
+ * Optimal cost of the global alignment of read and ref with the Gotoh DP.
+ */
+inline int reference_cost(const std::string& read, const std::string& ref, int x = 1, int o = 1, int e = 1) {
+    int m = static_cast<int>(read.size()), n = static_cast<int>(ref.size());
+    // H: any state, I: ends with an insertion (consumes read), D: ends with a deletion
+    std::vector<int> H((m + 1) * (n + 1), TEST_INF), I(H), D(H);
+    auto at = [&](int i, int j) { return i * (n + 1) + j; };
+    H[at(0, 0)] = 0;
+    for (int i = 0; i <= m; i++) {
+        for (int j = 0; j <= n; j++) {
+            if (i > 0) {
+                I[at(i, j)] = std::min(H[at(i - 1, j)] + o, I[at(i - 1, j)] + e);
+            }
+            if (j > 0) {
+                D[at(i, j)] = std::min(H[at(i, j - 1)] + o, D[at(i, j - 1)] + e);
+            }
+            if (i > 0 && j > 0) {
+                H[at(i, j)] = H[at(i - 1, j - 1)] + (read[i - 1] == ref[j - 1] ? 0 : x);
+            }
+            H[at(i, j)] = std::min({H[at(i, j)], I[at(i, j)], D[at(i, j)]});
+        }
+    }
+    return H[at(m, n)];
+}
+
+/**
+ * Optimal edit distance of the read against any substring of ref.
+ */
+inline int reference_semi_global_cost(const std::string& read, const std::string& ref) {
+    int m = static_cast<int>(read.size()), n = static_cast<int>(ref.size());
+    std::vector<int> previous(n + 1, 0), current(n + 1);
+    for (int i = 1; i <= m; i++) {
+        current[0] = i;
+        for (int j = 1; j <= n; j++) {
+            current[j] = std::min({previous[j - 1] + (read[i - 1] != ref[j - 1]), previous[j] + 1, current[j - 1] + 1});
+        }
+        std::swap(previous, current);
+    }
+    return *std::min_element(previous.begin(), previous.end());
+}
+
+/**
+ * Cost of the path given by a CIGAR string (M, =, X, I or D). Adjacent runs of the same
+ * operation count as one gap, as compress_CIGAR() would merge them. If `free_end_deletions`
+ * is set, deletions at both ends of the path are free (semi-global alignment).
+ * @return the cost, or -1 if the path does not cover both strings exactly, or an = or X
+ *         operation is wrong.
+ */
+inline int CIGAR_cost(const std::string& CIGAR, const std::string& read, const std::string& ref,
+                      int x = 1, int o = 1, int e = 1, bool free_end_deletions = false) {
+    std::string operations;
+    int length = 0;
+    for (char c : CIGAR) {
+        if (isdigit(c)) {
+            length = length * 10 + (c - '0');
+        } else {
+            operations.append(length, c);
+            length = 0;
+        }
+    }
+    size_t first = 0, last = operations.size();
+    if (free_end_deletions) {
+        while (first < last && operations[first] == 'D') first++;
+        while (last > first && operations[last - 1] == 'D') last--;
+    }
+    int cost = 0;
+    size_t i = 0, j = 0;
+    for (size_t t = 0; t < operations.size(); t++) {
+        char op = operations[t];
+        bool free = t < first || t >= last;
+        if (op == 'I' || op == 'D') {
+            if (!free) {
+                cost += (t > 0 && operations[t - 1] == op) ? e : o;
+            }
+            op == 'I' ? i++ : j++;
+            continue;
+        }
+        if (i >= read.size() || j >= ref.size()) {
+            return -1;
+        }
+        bool mismatch = read[i] != ref[j];
+        if ((op == '=' && mismatch) || (op == 'X' && !mismatch)) {
+            return -1;
+        }
+        cost += mismatch ? x : 0;
+        i++, j++;
+    }
+    if (i != read.size() || j != ref.size()) {
+        return -1;
+    }
+    return cost;
+}
+
+/**
+ * Count failed checks and print the first few of them.
+ */
+class test_checker {
+    int failures = 0;
+    int checks = 0;
+
+public:
+    bool check(bool condition, const char* what, const std::string& read, const std::string& ref, int actual, int expected) {
+        checks++;
+        if (!condition) {
+            if (failures < 10) {
+                printf("FAILED %s: got %d, expected %d\n  read %s\n  ref  %s\n", what, actual, expected, read.c_str(), ref.c_str());
+            }
+            failures++;
+        }
+        return condition;
+    }
+
+    /**
+     * Print the summary of a test.
+     * @return exit status of the test.
+     */
+    int report(const char* name) const {
+        printf("%s: %d checks, %d failed\n", name, checks, failures);
+        return failures == 0 ? 0 : 1;
+    }
+};
+
+#endif //GASMA_TEST_UTILS_H
@@ -0,0 +1,173 @@
+#ifndef GASMA_THREAD_POOL_H
+#define GASMA_THREAD_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * A fixed set of worker threads that process ranges of items with work stealing.
+ * The items are cut into chunks, and each worker starts with a contiguous share of the chunks
+ * in its own queue. A worker takes chunks from the front of its queue, and once it is empty,
+ * steals from the back of the queues of the other workers. Alignments of very different cost
+ * are therefore balanced without a shared counter that every worker contends on.
+ */
+class thread_pool {
+protected:
+    // queue of [begin, end) ranges owned by one worker
+    struct worker_queue {
+        std::mutex lock;
+        std::deque<std::pair<int, int>> chunks;
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<worker_queue>> queues;
+
+    // the task of the current batch, called as task(worker, begin, end)
+    std::function<void(int, int, int)> task;
+
+    // synchronization between parallel_for() and the workers
+    std::mutex state_lock;
+    std::condition_variable start_signal, finish_signal;
+    long generation;
+    int num_busy;
+    bool stopping;
+
+    /**
+     * Take the next chunk from the front of the worker's own queue.
+     */
+    bool _pop(int worker, std::pair<int, int>& chunk) {
+        worker_queue& queue = *queues[worker];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.chunks.empty()) {
+            return false;
+        }
+        chunk = queue.chunks.front();
+        queue.chunks.pop_front();
+        return true;
+    }
+
+    /**
+     * Take a chunk from the back of the queue of another worker, starting with the next one.
+     */
+    bool _steal(int thief, std::pair<int, int>& chunk) {
+        int num_workers = static_cast<int>(queues.size());
+        for (int offset = 1; offset < num_workers; offset++) {
+            worker_queue& queue = *queues[(thief + offset) % num_workers];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if (!queue.chunks.empty()) {
+                chunk = queue.chunks.back();
+                queue.chunks.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void _worker_loop(int worker) {
+        long seen_generation = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(state_lock);
+                start_signal.wait(lock, [&] { return stopping || generation != seen_generation; });
+                if (stopping) {
+                    return;
+                }
+                seen_generation = generation;
+            }
+
+            std::pair<int, int> chunk;
+            while (_pop(worker, chunk) || _steal(worker, chunk)) {
+                task(worker, chunk.first, chunk.second);
+            }
+
+            std::lock_guard<std::mutex> lock(state_lock);
+            if (--num_busy == 0) {
+                finish_signal.notify_all();
+            }
+        }
+    }
+
+public:
+    /**
+     * Start the worker threads.
+     * @param num_threads number of workers. Default: 0, i.e. one per hardware thread.
+     */
+    explicit thread_pool(int num_threads = 0) {
+        if (num_threads <= 0) {
+            num_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        }
+        generation = 0;
+        num_busy = 0;
+        stopping = false;
+        for (int i = 0; i < num_threads; i++) {
+            queues.push_back(std::make_unique<worker_queue>());
+        }
+        for (int i = 0; i < num_threads; i++) {
+            workers.emplace_back(&thread_pool::_worker_loop, this, i);
+        }
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    /**
+     * Return the number of workers.
+     */
+    int size() const {
+        return static_cast<int>(workers.size());
+    }
+
+    /**
+     * Process the items 0, ..., num_items - 1 and wait until all of them are done.
+     * Must not be called from several threads at the same time, and `f` must not throw.
+     * @param num_items number of items.
+     * @param chunk_size number of items a worker takes at once.
+     * @param f called as f(worker, begin, end) for each chunk [begin, end), where worker is
+     *          between 0 and size() - 1 and is never used by two threads at the same time.
+     */
+    void parallel_for(int num_items, int chunk_size, const std::function<void(int, int, int)>& f) {
+        if (num_items <= 0) {
+            return;
+        }
+        chunk_size = std::max(1, chunk_size);
+        int num_workers = size();
+        int num_chunks = (num_items + chunk_size - 1) / chunk_size;
+
+        std::unique_lock<std::mutex> lock(state_lock);
+        // worker w starts with chunks [w * num_chunks / num_workers, (w + 1) * num_chunks / num_workers)
+        for (int w = 0; w < num_workers; w++) {
+            std::lock_guard<std::mutex> guard(queues[w]->lock);
+            for (long c = (long) w * num_chunks / num_workers; c < (long) (w + 1) * num_chunks / num_workers; c++) {
+                int begin = static_cast<int>(c) * chunk_size;
+                queues[w]->chunks.emplace_back(begin, std::min(num_items, begin + chunk_size));
+            }
+        }
+        task = f;
+        num_busy = num_workers;
+        generation++;
+        start_signal.notify_all();
+        finish_signal.wait(lock, [&] { return num_busy == 0; });
+        task = nullptr;
+    }
+
+    ~thread_pool() {
+        {
+            std::lock_guard<std::mutex> lock(state_lock);
+            stopping = true;
+        }
+        start_signal.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+};
+
+
+#endif //GASMA_THREAD_POOL_H
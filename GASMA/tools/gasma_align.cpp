@@ -0,0 +1,350 @@
+/**
+ * gasma-align: align the pairs of a file (or stdin) with the greedy algorithm and write one
+ * line per pair in input order.
+ *
+ * Input, detected from the first character or set with -f:
+ *     seq: a line ">read" followed by a line "<ref" for each pair, as in the benchmark datasets.
+ *     tsv: one line "read<TAB>ref" per pair. Further columns are ignored.
+ * Output: "cost<TAB>CIGAR", and with -X "cost<TAB>=/X CIGAR<TAB>NM:i:..<TAB>MD:Z:..".
+ *
+ * Reading, aligning and writing run at the same time: a reader thread parses batches of pairs,
+ * the workers of a batch_aligner align them, and a writer thread prints them. Batches are
+ * recycled through a fixed pool, so the memory does not grow with the size of the input.
+ */
+
+#include <getopt.h>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../batch_aligner.h"
+
+#define DEFAULT_BATCH_SIZE 16384    // pairs per batch
+#define NUM_BATCHES 4               // batches in flight: being read, aligned and written
+#define IO_BUFFER_SIZE (4 << 20)    // stdio buffer of the input and the output
+
+/**
+ * Blocking FIFO queue with a fixed capacity, closed by the producer at the end of the stream.
+ */
+template <typename T>
+class bounded_queue {
+protected:
+    std::mutex lock;
+    std::condition_variable not_empty, not_full;
+    std::deque<T> items;
+    size_t capacity;
+    bool closed = false;
+
+public:
+    explicit bounded_queue(size_t _capacity) : capacity(_capacity) {}
+
+    void push(T item) {
+        std::unique_lock<std::mutex> guard(lock);
+        not_full.wait(guard, [&] { return items.size() < capacity; });
+        items.push_back(std::move(item));
+        not_empty.notify_one();
+    }
+
+    /**
+     * Take the first item, waiting for one if the queue is empty.
+     * @return false if the queue is closed and empty.
+     */
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> guard(lock);
+        not_empty.wait(guard, [&] { return !items.empty() || closed; });
+        if (items.empty()) {
+            return false;
+        }
+        item = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> guard(lock);
+        closed = true;
+        not_empty.notify_all();
+    }
+};
+
+enum input_format_t {
+    AUTO,
+    SEQ,
+    TSV
+};
+
+/**
+ * A batch of pairs with their results. The strings keep their capacity when the batch is
+ * reused, so a batch stops allocating after the first few uses.
+ */
+struct pair_batch {
+    std::vector<std::string> reads, refs;
+    std::vector<alignment_result> results;
+    std::vector<int> NM;
+    std::vector<std::string> MD;
+    int num_pairs = 0;
+
+    explicit pair_batch(int size) : reads(size), refs(size), results(size), NM(size), MD(size) {}
+};
+
+struct options_t {
+    int k = 3;
+    int x = 1, o = 1, e = 1;
+    int num_threads = 0;
+    int batch_size = DEFAULT_BATCH_SIZE;
+    alignment_type_t alignment_type = GLOBAL;
+    input_format_t format = AUTO;
+    bool polish = false;
+    bool extended = false;
+    const char* input = nullptr;
+    const char* output = nullptr;
+};
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options] [input]\n"
+            "Align the pairs of `input` (default: stdin) and print \"cost<TAB>CIGAR\" for each pair.\n"
+            "  -k INT   band width (default: 3)\n"
+            "  -x INT   mismatch penalty (default: 1)\n"
+            "  -o INT   gap opening penalty (default: 1)\n"
+            "  -e INT   gap extension penalty (default: 1)\n"
+            "  -s       semi-global alignment (free gaps at both ends of the reference)\n"
+            "  -p       polish the path around its leaps with an exact DP (global only)\n"
+            "  -X       print =/X CIGAR and the SAM NM and MD tags\n"
+            "  -f FMT   input format: seq, tsv or auto (default: auto)\n"
+            "  -t INT   number of threads (default: one per hardware thread)\n"
+            "  -b INT   pairs per batch (default: %d)\n"
+            "  -O FILE  output file (default: stdout)\n"
+            "  -h       print this help\n",
+            program, DEFAULT_BATCH_SIZE);
+}
+
+/**
+ * Read one line without the line break.
+ * @return false at the end of the input.
+ */
+static bool read_line(FILE* file, char*& buffer, size_t& capacity, std::string& line) {
+    ssize_t length = getline(&buffer, &capacity, file);
+    if (length < 0) {
+        return false;
+    }
+    while (length > 0 && (buffer[length - 1] == '\n' || buffer[length - 1] == '\r')) {
+        length--;
+    }
+    line.assign(buffer, length);
+    return true;
+}
+
+/**
+ * Parse the input into batches taken from `free_batches` and pass them to `parsed`.
+ * @return false if the input is malformed.
+ */
+static bool read_pairs(FILE* input, input_format_t format,
+                       bounded_queue<std::unique_ptr<pair_batch>>& free_batches,
+                       bounded_queue<std::unique_ptr<pair_batch>>& parsed) {
+    char* buffer = nullptr;
+    size_t capacity = 0;
+    std::string line;
+    long line_number = 0;
+    bool valid = true;
+    std::unique_ptr<pair_batch> batch;
+
+    while (valid && read_line(input, buffer, capacity, line)) {
+        line_number++;
+        if (line.empty()) {
+            continue;
+        }
+        if (format == AUTO) {
+            format = line[0] == '>' ? SEQ : TSV;
+        }
+        if (!batch) {
+            free_batches.pop(batch);
+            batch->num_pairs = 0;
+        }
+        std::string& read = batch->reads[batch->num_pairs];
+        std::string& ref = batch->refs[batch->num_pairs];
+        if (format == SEQ) {
+            if (line[0] != '>') {
+                fprintf(stderr, "gasma-align: line %ld: expected '>' before the read\n", line_number);
+                valid = false;
+                break;
+            }
+            read.assign(line, 1);
+            line_number++;
+            if (!read_line(input, buffer, capacity, line) || line.empty() || line[0] != '<') {
+                fprintf(stderr, "gasma-align: line %ld: expected '<' before the reference\n", line_number);
+                valid = false;
+                break;
+            }
+            ref.assign(line, 1);
+        } else {
+            size_t tab = line.find('\t');
+            if (tab == std::string::npos) {
+                fprintf(stderr, "gasma-align: line %ld: expected two tab-separated columns\n", line_number);
+                valid = false;
+                break;
+            }
+            size_t end = line.find('\t', tab + 1);
+            read.assign(line, 0, tab);
+            ref.assign(line, tab + 1, end == std::string::npos ? std::string::npos : end - tab - 1);
+        }
+        if (++batch->num_pairs == static_cast<int>(batch->reads.size())) {
+            parsed.push(std::move(batch));
+        }
+    }
+    if (batch && batch->num_pairs > 0) {
+        parsed.push(std::move(batch));
+    }
+    parsed.close();
+    free(buffer);
+    return valid;
+}
+
+/**
+ * Print the aligned batches in order and return them to `free_batches`.
+ * @return false if the output could not be written.
+ */
+static bool write_results(FILE* output, bool extended,
+                          bounded_queue<std::unique_ptr<pair_batch>>& aligned,
+                          bounded_queue<std::unique_ptr<pair_batch>>& free_batches) {
+    std::unique_ptr<pair_batch> batch;
+    while (aligned.pop(batch)) {
+        for (int i = 0; i < batch->num_pairs; i++) {
+            const alignment_result& result = batch->results[i];
+            if (extended) {
+                fprintf(output, "%d\t%s\tNM:i:%d\tMD:Z:%s\n", result.cost, result.CIGAR.c_str(),
+                        batch->NM[i], batch->MD[i].c_str());
+            } else {
+                fprintf(output, "%d\t%s\n", result.cost, result.CIGAR.c_str());
+            }
+        }
+        free_batches.push(std::move(batch));
+    }
+    return fflush(output) == 0 && !ferror(output);
+}
+
+int main(int argc, char** argv) {
+    options_t options;
+    int option;
+    while ((option = getopt(argc, argv, "k:x:o:e:spXf:t:b:O:h")) != -1) {
+        switch (option) {
+            case 'k': options.k = atoi(optarg); break;
+            case 'x': options.x = atoi(optarg); break;
+            case 'o': options.o = atoi(optarg); break;
+            case 'e': options.e = atoi(optarg); break;
+            case 's': options.alignment_type = SEMI_GLOBAL; break;
+            case 'p': options.polish = true; break;
+            case 'X': options.extended = true; break;
+            case 'f':
+                if (strcmp(optarg, "seq") == 0) options.format = SEQ;
+                else if (strcmp(optarg, "tsv") == 0) options.format = TSV;
+                else if (strcmp(optarg, "auto") == 0) options.format = AUTO;
+                else {
+                    fprintf(stderr, "gasma-align: unknown format '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 't': options.num_threads = atoi(optarg); break;
+            case 'b': options.batch_size = atoi(optarg); break;
+            case 'O': options.output = optarg; break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (optind < argc) {
+        options.input = argv[optind];
+    }
+    if (options.k < 0 || options.k > MAX_K || options.batch_size <= 0 || options.num_threads < 0) {
+        fprintf(stderr, "gasma-align: invalid band width, batch size or number of threads\n");
+        return 1;
+    }
+
+    FILE* input = stdin;
+    if (options.input != nullptr && strcmp(options.input, "-") != 0) {
+        input = fopen(options.input, "r");
+        if (input == nullptr) {
+            fprintf(stderr, "gasma-align: unable to open input file: %s\n", options.input);
+            return 1;
+        }
+    }
+    FILE* output = stdout;
+    if (options.output != nullptr) {
+        output = fopen(options.output, "w");
+        if (output == nullptr) {
+            fprintf(stderr, "gasma-align: unable to open output file: %s\n", options.output);
+            return 1;
+        }
+    }
+    setvbuf(input, nullptr, _IOFBF, IO_BUFFER_SIZE);
+    setvbuf(output, nullptr, _IOFBF, IO_BUFFER_SIZE);
+
+    batch_aligner<int_128bit> aligner(options.num_threads, options.k, options.alignment_type,
+                                      options.x, options.o, options.e);
+    bounded_queue<std::unique_ptr<pair_batch>> free_batches(NUM_BATCHES), parsed(NUM_BATCHES), aligned(NUM_BATCHES);
+    for (int i = 0; i < NUM_BATCHES; i++) {
+        free_batches.push(std::make_unique<pair_batch>(options.batch_size));
+    }
+
+    bool valid = true, written = true;
+    std::thread reader([&] { valid = read_pairs(input, options.format, free_batches, parsed); });
+    std::thread writer([&] { written = write_results(output, options.extended, aligned, free_batches); });
+
+    long num_truncated = 0;
+    std::unique_ptr<pair_batch> batch;
+    while (parsed.pop(batch)) {
+        pair_batch& pairs = *batch;
+        aligner.for_each(pairs.num_pairs, [&](hurdle_matrix<int_128bit>& matrix, int i) {
+            const std::string& read = pairs.reads[i];
+            const std::string& ref = pairs.refs[i];
+            matrix.reset(read.c_str(), static_cast<int>(read.size()), ref.c_str(), static_cast<int>(ref.size()), options.k);
+            matrix.run();
+            if (options.polish) {
+                matrix.polish();
+            }
+            alignment_result& result = pairs.results[i];
+            result.cost = matrix.get_cost();
+            result.termination = matrix.get_termination();
+            if (options.extended) {
+                matrix.resolve_mismatches();
+                result.CIGAR = matrix.get_extended_CIGAR();
+                pairs.NM[i] = matrix.get_NM();
+                pairs.MD[i] = matrix.get_MD();
+            } else {
+                result.CIGAR = matrix.get_CIGAR();
+            }
+        });
+        for (int i = 0; i < pairs.num_pairs; i++) {
+            num_truncated += pairs.reads[i].size() > MAX_LENGTH || pairs.refs[i].size() > MAX_LENGTH;
+        }
+        aligned.push(std::move(batch));
+    }
+    aligned.close();
+    reader.join();
+    writer.join();
+
+    if (num_truncated > 0) {
+        fprintf(stderr, "gasma-align: %ld pairs were longer than %d and only aligned up to that length\n",
+                num_truncated, MAX_LENGTH);
+    }
+    if (input != stdin) {
+        fclose(input);
+    }
+    if (output != stdout && fclose(output) != 0) {
+        written = false;
+    }
+    if (!written) {
+        fprintf(stderr, "gasma-align: error while writing %s\n", output == stdout ? "standard output" : options.output);
+        return 1;
+    }
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+/**
+ * gasma-compare: compare two benchmark results (the REPORT_PATH.csv of the benchmark, see
+ * benchmark_report.h), and flag the significant regressions of throughput, latency and
+ * accuracy. Exits with status 2 if there is a regression, so it can fail a build.
+ *
+ *     gasma-compare base.csv current.csv
+ *     gasma-compare -a 0.05 -r 0.05 -v base.csv current.csv
+ */
+
+#include <getopt.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "../benchmark/benchmark_report.h"
+
+struct options_t {
+    double alpha = 0.01;
+    double threshold = 0.02;
+    bool verbose = false;
+};
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options] base.csv current.csv\n"
+            "Compare two benchmark results and flag the significant regressions.\n"
+            "  -a REAL  significance level of the tests (default: 0.01)\n"
+            "  -r REAL  smallest relative change of a timing that is flagged (default: 0.02)\n"
+            "  -v       print every metric, not only the significant changes\n"
+            "  -h       print this help\n",
+            program);
+}
+
+/**
+ * Print the properties of the runs that differ, as they may explain the differences.
+ */
+static void print_meta(const benchmark_report& base, const benchmark_report& current) {
+    for (const auto& property : current.get_meta()) {
+        std::string before = base.get(property.first);
+        if (property.first != "date" && before != property.second) {
+            printf("%-16s | %s -> %s\n", property.first.c_str(), before.empty() ? "(none)" : before.c_str(),
+                   property.second.c_str());
+        }
+    }
+}
+
+static const char* verdict(const report_difference& difference) {
+    if (difference.regression) {
+        return "REGRESSION";
+    }
+    if (!difference.significant) {
+        return "";
+    }
+    return metric_direction(difference.current.metric) == 0 ? "changed" : "improved";
+}
+
+int main(int argc, char** argv) {
+    options_t options;
+    int option;
+    while ((option = getopt(argc, argv, "a:r:vh")) != -1) {
+        switch (option) {
+            case 'a': options.alpha = atof(optarg); break;
+            case 'r': options.threshold = atof(optarg); break;
+            case 'v': options.verbose = true; break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (argc - optind != 2 || options.alpha <= 0 || options.alpha >= 1 || options.threshold < 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    benchmark_report base, current;
+    if (!base.read_csv(argv[optind])) {
+        fprintf(stderr, "gasma-compare: not a benchmark result: %s\n", argv[optind]);
+        return 1;
+    }
+    if (!current.read_csv(argv[optind + 1])) {
+        fprintf(stderr, "gasma-compare: not a benchmark result: %s\n", argv[optind + 1]);
+        return 1;
+    }
+
+    print_meta(base, current);
+    std::vector<report_difference> differences = compare_reports(base, current, options.alpha, options.threshold);
+    int num_significant = 0, num_regressions = 0;
+    printf("%-16s | %-17s | %-16s | %12s | %12s | %8s | %9s |\n", "dataset", "engine", "metric", "base",
+           "current", "change", "p-value");
+    for (const report_difference& difference : differences) {
+        num_significant += difference.significant;
+        num_regressions += difference.regression;
+        if (!options.verbose && !difference.significant) {
+            continue;
+        }
+        char p_value[16] = "-";
+        if (!std::isnan(difference.p_value)) {
+            snprintf(p_value, sizeof(p_value), "%9.2g", difference.p_value);
+        }
+        printf("%-16s | %-17s | %-16s | %12.4g | %12.4g | %+7.2f%% | %9s | %s\n", difference.current.dataset.c_str(),
+               difference.current.engine.c_str(), difference.current.metric.c_str(), difference.base.value,
+               difference.current.value, difference.change * 100, p_value, verdict(difference));
+    }
+    printf("%zu metrics compared, %d significant changes, %d regressions.\n", differences.size(), num_significant,
+           num_regressions);
+    return num_regressions > 0 ? 2 : 0;
+}
@@ -0,0 +1,152 @@
+/**
+ * gasma-convert: convert a text dataset into a pair file (see pair_file.h), or back.
+ *
+ *     gasma-convert [-a answers] input.seq output.gsp      text to binary
+ *     gasma-convert -d [-a answers] input.gsp output.seq   binary to text
+ *
+ * The text format is the one of the benchmark datasets: a line ">read" followed by a line
+ * "<ref" for each pair. The answer file holds the optimal cost of each pair, one per line; it
+ * is stored in the pair file when converting to binary, and written when converting back.
+ */
+
+#include <getopt.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../pair_file.h"
+#include "../benchmark/mapped_dataset.h"
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options] input output\n"
+            "Convert a \">read\" / \"<ref\" text dataset into a binary pair file.\n"
+            "  -a FILE  optimal costs, one per line (written instead of read with -d)\n"
+            "  -d       convert a pair file back into a text dataset\n"
+            "  -h       print this help\n",
+            program);
+}
+
+/**
+ * Remove the leading '>' or '<' of a line of the text format.
+ */
+static std::string_view strip(std::string_view line) {
+    return !line.empty() && (line[0] == '>' || line[0] == '<') ? line.substr(1) : line;
+}
+
+static int encode(const char* input, const char* output, const char* answers) {
+    mapped_dataset dataset(input);
+    if (!dataset.is_open()) {
+        fprintf(stderr, "gasma-convert: unable to open input file: %s\n", input);
+        return 1;
+    }
+    std::vector<int> costs;
+    if (answers != nullptr) {
+        mapped_dataset answer_file(answers);
+        if (!answer_file.is_open()) {
+            fprintf(stderr, "gasma-convert: unable to open answer file: %s\n", answers);
+            return 1;
+        }
+        costs.reserve(answer_file.num_lines());
+        for (size_t i = 0; i < answer_file.num_lines(); i++) {
+            costs.push_back(atoi(std::string(answer_file.line(i)).c_str()));
+        }
+    }
+
+    pair_file_writer writer(output);
+    if (!writer.is_open()) {
+        fprintf(stderr, "gasma-convert: unable to open output file: %s\n", output);
+        return 1;
+    }
+    size_t num_pairs = dataset.num_lines() / 2;
+    long unknown = 0;
+    for (size_t i = 0; i < num_pairs; i++) {
+        std::string_view read = strip(dataset.line(2 * i));
+        std::string_view ref = strip(dataset.line(2 * i + 1));
+        if (read.length() > UINT16_MAX || ref.length() > UINT16_MAX) {
+            fprintf(stderr, "gasma-convert: pair %zu is longer than %d characters\n", i, UINT16_MAX);
+            return 1;
+        }
+        int32_t cost = i < costs.size() ? costs[i] : PAIR_FILE_NO_COST;
+        unknown += writer.write(read.data(), (int) read.length(), ref.data(), (int) ref.length(), cost);
+    }
+    if (!writer.close()) {
+        fprintf(stderr, "gasma-convert: unable to write output file: %s\n", output);
+        return 1;
+    }
+    if (unknown > 0) {
+        fprintf(stderr, "gasma-convert: warning: %ld characters other than A, C, G and T are stored as A\n", unknown);
+    }
+    if (answers != nullptr && costs.size() != num_pairs) {
+        fprintf(stderr, "gasma-convert: warning: %zu costs for %zu pairs\n", costs.size(), num_pairs);
+    }
+    return 0;
+}
+
+static int decode(const char* input, const char* output, const char* answers) {
+    pair_file_reader reader(input);
+    if (!reader.is_open()) {
+        fprintf(stderr, "gasma-convert: not a valid pair file: %s\n", input);
+        return 1;
+    }
+    FILE* text = fopen(output, "w");
+    FILE* answer_file = answers == nullptr ? nullptr : fopen(answers, "w");
+    if (text == nullptr || (answers != nullptr && answer_file == nullptr)) {
+        fprintf(stderr, "gasma-convert: unable to open output file\n");
+        return 1;
+    }
+    std::string read, ref;
+    for (size_t i = 0; i < reader.num_pairs(); i++) {
+        read.resize(reader.read_length(i));
+        ref.resize(reader.ref_length(i));
+        decode_2bit(reader.read_packed(i), (int) read.length(), read.data());
+        decode_2bit(reader.ref_packed(i), (int) ref.length(), ref.data());
+        fprintf(text, ">%s\n<%s\n", read.c_str(), ref.c_str());
+        if (answer_file != nullptr && reader.cost(i) != PAIR_FILE_NO_COST) {
+            fprintf(answer_file, "%d\n", reader.cost(i));
+        }
+    }
+    bool success = fclose(text) == 0;
+    if (answer_file != nullptr) {
+        success = fclose(answer_file) == 0 && success;
+    }
+    if (!success) {
+        fprintf(stderr, "gasma-convert: unable to write output file\n");
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    const char* answers = nullptr;
+    bool to_text = false;
+    int option;
+    while ((option = getopt(argc, argv, "a:dh")) != -1) {
+        switch (option) {
+            case 'a': answers = optarg; break;
+            case 'd': to_text = true; break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (argc - optind != 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    int status = to_text ? decode(argv[optind], argv[optind + 1], answers)
+                         : encode(argv[optind], argv[optind + 1], answers);
+    if (status == 0) {
+        fprintf(stderr, "gasma-convert: %s -> %s (%.3f s)\n", argv[optind], argv[optind + 1],
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return status;
+}
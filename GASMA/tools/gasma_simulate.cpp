@@ -0,0 +1,107 @@
+/**
+ * gasma-simulate: simulate a dataset with a sequencing error model (see read_simulator.h),
+ * together with the true CIGAR of each pair.
+ *
+ *     gasma-simulate -p nanopore -n 1000000 -c truth.cigar output.seq
+ *     gasma-simulate -P real.cigar -n 1000000 output.seq
+ */
+
+#include <getopt.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../benchmark/read_simulator.h"
+
+struct options_t {
+    const char* profile = "illumina";
+    const char* learn = nullptr;
+    const char* CIGARs = nullptr;
+    const char* output = nullptr;
+    int num_pairs = 100000;
+    int length = 100;
+    int max_length = MAX_LENGTH;
+    uint64_t seed = DATASET_DEFAULT_SEED;
+    int num_threads = 0;
+};
+
+static void print_usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options] output\n"
+            "Simulate \">read\" / \"<ref\" pairs with a sequencing error model.\n"
+            "  -p NAME  error model: illumina or nanopore (default: illumina)\n"
+            "  -P FILE  learn the error model from the CIGARs of FILE, one per line\n"
+            "  -n INT   number of pairs (default: 100000)\n"
+            "  -l INT   (mean) read length (default: 100)\n"
+            "  -L INT   largest read and reference length of the nanopore model (default: %d)\n"
+            "  -s INT   seed (default: %d)\n"
+            "  -t INT   number of threads (default: one per hardware thread)\n"
+            "  -c FILE  write the true CIGAR of each pair\n"
+            "  -h       print this help\n",
+            program, MAX_LENGTH, DATASET_DEFAULT_SEED);
+}
+
+int main(int argc, char** argv) {
+    options_t options;
+    int option;
+    while ((option = getopt(argc, argv, "p:P:n:l:L:s:t:c:h")) != -1) {
+        switch (option) {
+            case 'p': options.profile = optarg; break;
+            case 'P': options.learn = optarg; break;
+            case 'n': options.num_pairs = atoi(optarg); break;
+            case 'l': options.length = atoi(optarg); break;
+            case 'L': options.max_length = atoi(optarg); break;
+            case 's': options.seed = strtoull(optarg, nullptr, 10); break;
+            case 't': options.num_threads = atoi(optarg); break;
+            case 'c': options.CIGARs = optarg; break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (argc - optind != 1 || options.num_pairs < 0 || options.length <= 0 || options.num_threads < 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    options.output = argv[optind];
+
+    error_profile profile;
+    if (options.learn != nullptr) {
+        std::ifstream file(options.learn);
+        if (!file) {
+            fprintf(stderr, "gasma-simulate: unable to open CIGAR file: %s\n", options.learn);
+            return 1;
+        }
+        std::vector<std::string> CIGARs;
+        std::string line;
+        while (std::getline(file, line)) {
+            CIGARs.push_back(line);
+        }
+        profile = error_profile::from_CIGARs(CIGARs);
+        fprintf(stderr, "gasma-simulate: learned from %zu CIGARs: substitution %.4f, insertion %.4f, deletion %.4f\n",
+                CIGARs.size(), profile.substitution_rate, profile.insertion_rate, profile.deletion_rate);
+    } else if (strcmp(options.profile, "illumina") == 0) {
+        profile = error_profile::illumina(options.length);
+    } else if (strcmp(options.profile, "nanopore") == 0) {
+        profile = error_profile::nanopore(options.length, options.max_length);
+    } else {
+        fprintf(stderr, "gasma-simulate: unknown error model '%s'\n", options.profile);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    read_simulator simulator(profile, options.seed, options.num_threads);
+    if (!simulator.output(options.num_pairs, options.output, options.CIGARs)) {
+        return 1;
+    }
+    fprintf(stderr, "gasma-simulate: %d pairs -> %s (%.3f s)\n", options.num_pairs, options.output,
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    return 0;
+}
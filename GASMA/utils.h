@@ -11,9 +11,13 @@
 #ifndef GASMA_UTILS_H
 #define GASMA_UTILS_H
 
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <string>
 #include <x86intrin.h>
 
 #include "bit_convert.h"
@@ -34,7 +38,7 @@
  * @param data the array of uint8_t needed for printing
  * @param length the length of this array
  */
-void print_byte_vector(uint8_t *data, int length) {
+inline void print_byte_vector(uint8_t *data, int length) {
     for (int i = 0; i < length; i++) {
         for (int m = 0; m < 8; m++) {
             if (data[i] & (1ULL << m))
@@ -51,6 +55,9 @@ private:
     __m128i val;
 
 public:
+    // number of bits stored in the vector
+    static constexpr int width = 128;
+
     /**
      * Default constructor of the class `int_128bit`. Set value to be 1.
      */
@@ -167,7 +174,7 @@ public:
      */
     int first_one() {
         // TODO: replace this with de Brujin Sequence that is faster than scanning
-        uint64_t data [2] __aligned;
+        uint64_t data [2] GASMA_ALIGNED;
         _mm_store_si128((__m128i *) data, this->val);
         int count = 0;
         int trailing_zeros;
@@ -190,6 +197,24 @@ public:
         return data.first_one();
     }
 
+    /**
+     * Reverse the order of the lowest `length` bits, i.e. bit i moves to bit length - 1 - i.
+     * Bits at and above `length` are cleared.
+     * @param length the number of bits to reverse.
+     * @return this->val with the lowest `length` bits reversed.
+     */
+    int_128bit reverse(int length = 128) {
+        const __m128i byte_order = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+        const __m128i nibble_reversed = _mm_setr_epi8(0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE,
+                                                      0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF);
+        const __m128i low_mask = _mm_set1_epi8(0x0F);
+        __m128i vec = _mm_shuffle_epi8(this->val, byte_order);
+        __m128i lower_bits = _mm_shuffle_epi8(nibble_reversed, _mm_and_si128(vec, low_mask));
+        __m128i upper_bits = _mm_shuffle_epi8(nibble_reversed, _mm_and_si128(_mm_srli_epi16(vec, 4), low_mask));
+        int_128bit reversed = _mm_or_si128(_mm_slli_epi16(lower_bits, 4), upper_bits);
+        return reversed.shift_left(128 - length);
+    }
+
     /**
      * Flip the short 1 bit in this->val if both of its neighbors are zeros
      * @param threshold the number of neighboring 0 in order to flip the hurdle. Only support 1 and 2.
@@ -268,6 +293,30 @@ public:
         //printf("%d\n", shifted.pop_count());
         return shifted.pop_count();
     }
+
+    /**
+     * Add that to this->val as one 128-bit unsigned integer, i.e. carries propagate
+     * from the lower word to the higher word. The final carry is dropped.
+     * @param that an int_128bit object.
+     * @return this + that
+     */
+    int_128bit add(const int_128bit &that) {
+        const __m128i sign = _mm_set1_epi64x(INT64_MIN);
+        __m128i sum = _mm_add_epi64(this->val, that.val);
+        // a word overflowed iff its sum is (unsigned) smaller than the operand
+        __m128i carry = _mm_cmpgt_epi64(_mm_xor_si128(this->val, sign), _mm_xor_si128(sum, sign));
+        carry = _mm_slli_si128(carry, 8);
+        return _mm_sub_epi64(sum, carry);
+    }
+
+    /**
+     * Return whether the `index`-th bit is set.
+     */
+    bool test_bit(int index) {
+        uint64_t data [2] GASMA_ALIGNED;
+        _mm_store_si128((__m128i *) data, this->val);
+        return (data[index >> 6] >> (index & 63)) & 1;
+    }
 };
 
 
@@ -275,7 +324,28 @@ class int_256bit {
 private:
     __m256i val;
 
+    /**
+     * Move each 64-bit word to the next higher word, across the 128-bit lanes
+     * (`_mm256_slli_si256` only shifts within each lane).
+     */
+    static __m256i _shift_words_up(__m256i vec) {
+        return _mm256_blend_epi32(_mm256_permute4x64_epi64(vec, _MM_SHUFFLE(2, 1, 0, 0)),
+                                  _mm256_setzero_si256(), 0x03);
+    }
+
+    /**
+     * Move each 64-bit word to the next lower word, across the 128-bit lanes
+     * (`_mm256_srli_si256` only shifts within each lane).
+     */
+    static __m256i _shift_words_down(__m256i vec) {
+        return _mm256_blend_epi32(_mm256_permute4x64_epi64(vec, _MM_SHUFFLE(3, 3, 2, 1)),
+                                  _mm256_setzero_si256(), 0xC0);
+    }
+
 public:
+    // number of bits stored in the vector
+    static constexpr int width = 256;
+
     /**
      * Default constructor of the class `int_256bit`. Set value to be 0.
      */
@@ -357,32 +427,40 @@ public:
 
 
     int_256bit shift_right(int shift_num) {
+        if (shift_num >= 256) {
+            // shifting out all the bits, as int_128bit does for 128 bits or more
+            return _mm256_setzero_si256();
+        }
         __m256i vec = this->val;
         if (shift_num >= 128) {
             vec = _mm256_inserti128_si256(_mm256_setzero_si256(), _mm256_extracti128_si256(vec, 0), 1);
             shift_num = shift_num % 128;
         }
         if (shift_num >= 64) {
-            vec = _mm256_slli_si256(vec, 8);
+            vec = _shift_words_up(vec);
             shift_num = shift_num % 64;
         }
-        __m256i carryover = _mm256_slli_si256(vec, 8);
+        __m256i carryover = _shift_words_up(vec);
         carryover = _mm256_srli_epi64(carryover, 64 - shift_num);
         vec = _mm256_slli_epi64(vec, shift_num);
         return _mm256_or_si256(vec, carryover);
     }
 
     int_256bit shift_left(int shift_num) {
+        if (shift_num >= 256) {
+            // shifting out all the bits, as int_128bit does for 128 bits or more
+            return _mm256_setzero_si256();
+        }
         __m256i vec = this->val;
         if (shift_num >= 128) {
             vec = _mm256_inserti128_si256(_mm256_setzero_si256(), _mm256_extracti128_si256(vec, 1), 0);
             shift_num = shift_num % 128;
         }
         if (shift_num >= 64) {
-            vec = _mm256_srli_si256(vec, 8);
+            vec = _shift_words_down(vec);
             shift_num = shift_num % 64;
         }
-        __m256i carryover = _mm256_srli_si256(vec, 8);
+        __m256i carryover = _shift_words_down(vec);
         carryover = _mm256_slli_epi64(carryover, 64 - shift_num);
         vec = _mm256_srli_epi64(vec, shift_num);
         return _mm256_or_si256(vec, carryover);
@@ -403,7 +481,7 @@ public:
      */
     int first_one() {
         // TODO: replace this with de Brujin Sequence that is faster than scanning
-        uint64_t data [4] __aligned;
+        uint64_t data [4] GASMA_ALIGNED;
         _mm256_store_si256((__m256i *) data, this->val);
         int count = 0;
         int trailing_zeros;
@@ -426,6 +504,31 @@ public:
         return data.first_one();
     }
 
+    /**
+     * Reverse the order of the lowest `length` bits, i.e. bit i moves to bit length - 1 - i.
+     * Bits at and above `length` are cleared.
+     * @param length the number of bits to reverse.
+     * @return this->val with the lowest `length` bits reversed.
+     */
+    int_256bit reverse(int length = 256) {
+        if (length <= 0) {
+            return _mm256_setzero_si256();
+        }
+        const __m256i byte_order = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+                                                    15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+        const __m256i nibble_reversed = _mm256_setr_epi8(0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE,
+                                                         0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF,
+                                                         0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE,
+                                                         0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF);
+        const __m256i low_mask = _mm256_set1_epi8(0x0F);
+        __m256i vec = _mm256_shuffle_epi8(this->val, byte_order);
+        vec = _mm256_permute2x128_si256(vec, vec, 0x01);
+        __m256i lower_bits = _mm256_shuffle_epi8(nibble_reversed, _mm256_and_si256(vec, low_mask));
+        __m256i upper_bits = _mm256_shuffle_epi8(nibble_reversed, _mm256_and_si256(_mm256_srli_epi16(vec, 4), low_mask));
+        int_256bit reversed = _mm256_or_si256(_mm256_slli_epi16(lower_bits, 4), upper_bits);
+        return reversed.shift_left(256 - length);
+    }
+
 
 
     /**
@@ -480,7 +583,7 @@ public:
         return shifted.pop_count();
     }
 
-    uint8_t POPCOUNT[32] __aligned = {
+    uint8_t POPCOUNT[32] GASMA_ALIGNED = {
         /* 0 */0,
         /* 1 */1,
         /* 2 */1,
@@ -514,7 +617,7 @@ public:
         /* e */3,
         /* f */4 };
 
-    uint8_t __MASK_0F_[32] __aligned = {
+    uint8_t __MASK_0F_[32] GASMA_ALIGNED = {
             0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf,
             0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf,
             0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf,
@@ -546,8 +649,337 @@ public:
 
         return (int) result;
     }
+
+    /**
+     * Add that to this->val as one 256-bit unsigned integer, i.e. carries propagate
+     * from the lower words to the higher words. The final carry is dropped.
+     * @param that an int_256bit object.
+     * @return this + that
+     */
+    int_256bit add(const int_256bit &that) {
+        // a carry may ripple through several words, so add with the scalar carry chain
+        uint64_t a [4] __attribute__((aligned(32)));
+        uint64_t b [4] __attribute__((aligned(32)));
+        _mm256_store_si256((__m256i *) a, this->val);
+        _mm256_store_si256((__m256i *) b, that.val);
+        unsigned char carry = 0;
+        for (int i = 0; i < 4; i++) {
+            carry = _addcarry_u64(carry, a[i], b[i], (unsigned long long *) &a[i]);
+        }
+        return _mm256_load_si256((__m256i *) a);
+    }
+
+    /**
+     * Return whether the `index`-th bit is set.
+     */
+    bool test_bit(int index) {
+        uint64_t data [4] __attribute__((aligned(32)));
+        _mm256_store_si256((__m256i *) data, this->val);
+        return (data[index >> 6] >> (index & 63)) & 1;
+    }
 };
 
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+class int_512bit {
+private:
+    __m512i val;
+
+    /**
+     * Move each 64-bit word `words` words higher, filling the vacated words with zeros.
+     */
+    static __m512i _shift_words_up(__m512i vec, int words) {
+        const __m512i index = _mm512_sub_epi64(_mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7), _mm512_set1_epi64(words));
+        return _mm512_maskz_permutexvar_epi64((__mmask8) (0xFF << words), index, vec);
+    }
+
+    /**
+     * Move each 64-bit word `words` words lower, filling the vacated words with zeros.
+     */
+    static __m512i _shift_words_down(__m512i vec, int words) {
+        const __m512i index = _mm512_add_epi64(_mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7), _mm512_set1_epi64(words));
+        return _mm512_maskz_permutexvar_epi64((__mmask8) (0xFF >> words), index, vec);
+    }
+
+    /**
+     * Shift each 64-bit word `bits` bits up. The zero-masked form takes _mm512_setzero_si512()
+     * where _mm512_slli_epi64() takes an undefined vector, which GCC 12 reports as maybe
+     * uninitialized.
+     */
+    static __m512i _shift_bits_up(__m512i vec, unsigned int bits) {
+        return _mm512_maskz_slli_epi64((__mmask8) 0xFF, vec, bits);
+    }
+
+    /**
+     * Shift each 64-bit word `bits` bits down, as _shift_bits_up().
+     */
+    static __m512i _shift_bits_down(__m512i vec, unsigned int bits) {
+        return _mm512_maskz_srli_epi64((__mmask8) 0xFF, vec, bits);
+    }
+
+public:
+    // number of bits stored in the vector
+    static constexpr int width = 512;
+
+    /**
+     * Default constructor of the class `int_512bit`. Set value to be 0.
+     */
+    int_512bit() {
+        val = _mm512_setzero_si512();
+    }
+
+    /**
+     * Copy constructor of the class `int_512bit` that copies a __m512i object.
+     */
+    int_512bit(const __m512i & that) {
+        val = that;
+    }
+
+    /**
+     * Copy constructor of the class `int_512bit` that copies an array of uint8_t
+     * of length 64.
+     */
+    int_512bit(const uint8_t * that) {
+        val = _mm512_loadu_si512(that);
+    }
+
+    /**
+     * Print the value of `val` in binary format.
+     */
+    void print() {
+        auto *val_uint8 = (uint8_t*) &this->val;
+        print_byte_vector(val_uint8, 64);
+        printf("\n");
+    }
+
+    /**
+     * Print the value of `val` in hexadecimal format.
+     */
+    void print_hex() {
+        auto *v = (uint8_t*) &this->val;
+        for (int i = 0; i < 64; i++) {
+            printf("%x", v[i]);
+        }
+        printf("\n");
+    }
+
+    /**
+     * Perform bit-wise xor with that.
+     * @param that an int_512bit object.
+     * @return this ^ that
+     */
+    int_512bit _xor(const int_512bit &that) {
+        return _mm512_xor_si512(this->val, that.val);
+    }
+
+    /**
+     * Perform bit-wise or with that.
+     * @param that an int_512bit object.
+     * @return this | that
+     */
+    int_512bit _or(const int_512bit &that) {
+        return _mm512_or_si512(this->val, that.val);
+    }
+
+    /**
+    * Perform bit-wise and with that.
+    * @param that an int_512bit object.
+    * @return this & that
+    */
+    int_512bit _and(const int_512bit &that) {
+        return _mm512_and_si512(this->val, that.val);
+    }
+
+    /**
+    * Perform bit-wise not.
+    * @return !this
+    */
+    int_512bit _not() {
+        return _mm512_xor_si512(this->val, _mm512_set1_epi64(-1));
+    }
+
+    int_512bit shift_right(int shift_num) {
+        if (shift_num >= 512) {
+            return _mm512_setzero_si512();
+        }
+        __m512i vec = _shift_words_up(this->val, shift_num / 64);
+        shift_num = shift_num % 64;
+        if (shift_num == 0) {
+            return vec;
+        }
+        __m512i carryover = _shift_words_up(vec, 1);
+        carryover = _shift_bits_down(carryover, 64 - shift_num);
+        vec = _shift_bits_up(vec, shift_num);
+        return _mm512_or_si512(vec, carryover);
+    }
+
+    int_512bit shift_left(int shift_num) {
+        if (shift_num >= 512) {
+            return _mm512_setzero_si512();
+        }
+        __m512i vec = _shift_words_down(this->val, shift_num / 64);
+        shift_num = shift_num % 64;
+        if (shift_num == 0) {
+            return vec;
+        }
+        __m512i carryover = _shift_words_down(vec, 1);
+        carryover = _shift_bits_up(carryover, 64 - shift_num);
+        vec = _shift_bits_down(vec, shift_num);
+        return _mm512_or_si512(vec, carryover);
+    }
+
+    int_512bit shift_right_one() {
+        int_512bit one = _mm512_setr_epi64(1, 0, 0, 0, 0, 0, 0, 0);
+        return this->shift_right(1)._or(one);
+    }
+
+    int_512bit shift_left_one() {
+        int_512bit reversed_one = _mm512_setr_epi64(0, 0, 0, 0, 0, 0, 0, INT64_MIN);
+        return this->shift_left(1)._or(reversed_one);
+    }
+
+    /**
+     * Return the index of the lowest set bit.
+     */
+    int first_one() {
+        __mmask8 nonzero = _mm512_test_epi64_mask(this->val, this->val);
+        if (nonzero == 0) {
+            return 512;
+        }
+        uint64_t data [8];
+        _mm512_storeu_si512(data, this->val);
+        int word = static_cast<int>(_tzcnt_u32(nonzero));
+        return word * 64 + static_cast<int>(_tzcnt_u64(data[word]));
+    }
+
+    /**
+     * Return the index of the lowest unset bit.
+     */
+    int first_zero() {
+        auto data = this->_not();
+        return data.first_one();
+    }
+
+    /**
+     * Reverse the order of the lowest `length` bits, i.e. bit i moves to bit length - 1 - i.
+     * Bits at and above `length` are cleared.
+     * @param length the number of bits to reverse.
+     * @return this->val with the lowest `length` bits reversed.
+     */
+    int_512bit reverse(int length = 512) {
+        if (length <= 0) {
+            return _mm512_setzero_si512();
+        }
+        const __m512i byte_order = _mm512_maskz_broadcast_i32x4((__mmask16) 0xFFFF, _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8,
+                                                                                                7, 6, 5, 4, 3, 2, 1, 0));
+        const __m512i nibble_reversed = _mm512_maskz_broadcast_i32x4((__mmask16) 0xFFFF, _mm_setr_epi8(0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE,
+                                                                                                     0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF));
+        const __m512i low_mask = _mm512_set1_epi8(0x0F);
+        __m512i vec = _mm512_shuffle_epi8(this->val, byte_order);
+        vec = _mm512_maskz_shuffle_i64x2((__mmask8) 0xFF, vec, vec, _MM_SHUFFLE(0, 1, 2, 3));
+        __m512i lower_bits = _mm512_shuffle_epi8(nibble_reversed, _mm512_and_si512(vec, low_mask));
+        __m512i upper_bits = _mm512_shuffle_epi8(nibble_reversed, _mm512_and_si512(_mm512_srli_epi16(vec, 4), low_mask));
+        int_512bit reversed = _mm512_or_si512(_mm512_slli_epi16(lower_bits, 4), upper_bits);
+        return reversed.shift_left(512 - length);
+    }
+
+    /**
+     * Flip the short 1 bit in this->val if both of its neighbors are zeros
+     * @param threshold the number of neighboring 0 in order to flip the hurdle. Only support 1 and 2.
+     * @return this->val with short 1 bits flipped.
+     */
+    int_512bit flip_short_hurdles(int threshold) {
+        int_512bit l1 = this->shift_left(1);
+        int_512bit r1 = this->shift_right(1);
+        int_512bit l2, r2;
+        if (threshold > 1) {
+            l2 = this->shift_left(2);
+            r2 = this->shift_right(2);
+        }
+
+        int_512bit mask_1 = l1._or(r1);
+        if (threshold > 1) {
+            int_512bit mask_2 = l2._or(r2)._or(mask_1);
+            return this->_and(mask_2);
+        } else {
+            return this->_and(mask_1);
+        }
+    }
+
+    /**
+     * Flip the short 0 bit in this->val if both of its neighbors are ones
+     * @param threshold the number of short consecutive matches to neglect. Only support 1 and 2.
+     * @return this->val with short 0 bits flipped.
+     */
+    int_512bit flip_short_matches(int threshold) {
+        int_512bit l1 = this->shift_left_one();
+        int_512bit r1 = this->shift_right_one();
+        int_512bit l2, r2;
+        if (threshold > 1) {
+            l2 = l1.shift_left_one();
+            r2 = l2.shift_right_one();
+        }
+
+        int_512bit mask_1 = l1._and(r1);
+        if (threshold > 1) {
+            int_512bit mask_2 = l1._and(r2)._or(l2._and(r1));
+            return this->_or(mask_1)._or(mask_2);
+        } else {
+            return this->_or(mask_1);
+        }
+    }
+
+    /**
+     * Count the number of set bits in this->val using hardware POPCNT instruction on each word.
+     * @return an integer showing the number of set bits in this->val.
+     */
+    int pop_count() {
+        uint64_t data [8];
+        _mm512_storeu_si512(data, this->val);
+        int count = 0;
+        for (uint64_t i : data) {
+            count += static_cast<int>(_mm_popcnt_u64(i));
+        }
+        return count;
+    }
+
+    /**
+     * Count the number of ones from the `from`-th bit to the `to`-th bit.
+     * In particular we count between [`from`, `to`).
+     */
+    int pop_count_between(int from = 0, int to = 512) {
+        int_512bit shifted = this->shift_left(from).shift_right(from + 512 - to);
+        return shifted.pop_count();
+    }
+
+    /**
+     * Add that to this->val as one 512-bit unsigned integer, i.e. carries propagate
+     * from the lower words to the higher words. The final carry is dropped.
+     * @param that an int_512bit object.
+     * @return this + that
+     */
+    int_512bit add(const int_512bit &that) {
+        uint64_t a [8];
+        uint64_t b [8];
+        _mm512_storeu_si512(a, this->val);
+        _mm512_storeu_si512(b, that.val);
+        unsigned char carry = 0;
+        for (int i = 0; i < 8; i++) {
+            carry = _addcarry_u64(carry, a[i], b[i], (unsigned long long *) &a[i]);
+        }
+        return _mm512_loadu_si512(a);
+    }
+
+    /**
+     * Return whether the `index`-th bit is set.
+     */
+    bool test_bit(int index) {
+        uint64_t data [8];
+        _mm512_storeu_si512(data, this->val);
+        return (data[index >> 6] >> (index & 63)) & 1;
+    }
+};
+#endif
+
 /**
  * Alignment options
  */
@@ -565,6 +997,15 @@ enum gap_penalty_t {
     AFFINE
 };
 
+/**
+ * Reason why an alignment engine stopped.
+ */
+enum termination_t {
+    COMPLETED,          // reached the destination
+    COST_EXCEEDED,      // accumulated cost went over the cost budget
+    STEPS_EXCEEDED      // number of steps went over the step budget
+};
+
 /**
  * Calculate the linear leaping from lane1 to lane2.
  * @param lane1 The lane number that we come from.
@@ -573,7 +1014,7 @@ enum gap_penalty_t {
  * @param e gap extension penalty
  * @return The leaping penalty.
  */
-int switch_lane_penalty(int lane1, int lane2, int o = 1, int e = 1) {
+inline int switch_lane_penalty(int lane1, int lane2, int o = 1, int e = 1) {
     if (lane1 == lane2) return 0;
     return o + e * (abs(lane1 - lane2) - 1);
 }
@@ -584,7 +1025,7 @@ int switch_lane_penalty(int lane1, int lane2, int o = 1, int e = 1) {
  * @param lane2 The lane number that we are going to.
  * @return The number of columns skipped.
  */
-int switch_forward_column(int lane1, int lane2) {
+inline int switch_forward_column(int lane1, int lane2) {
     if (lane1 * lane2 >= 0) {
         if (abs(lane1) > abs(lane2)) return abs(lane1) - abs(lane2);
         else return 0;
@@ -592,5 +1033,84 @@ int switch_forward_column(int lane1, int lane2) {
     return abs(lane1);
 }
 
+/**
+ * Gather the even bits of a 64-bit word into its lowest 32 bits.
+ */
+inline uint64_t compact_even_bits(uint64_t word) {
+    word &= 0x5555555555555555ULL;
+    word = (word | (word >> 1)) & 0x3333333333333333ULL;
+    word = (word | (word >> 2)) & 0x0F0F0F0F0F0F0F0FULL;
+    word = (word | (word >> 4)) & 0x00FF00FF00FF00FFULL;
+    word = (word | (word >> 8)) & 0x0000FFFF0000FFFFULL;
+    word = (word | (word >> 16)) & 0x00000000FFFFFFFFULL;
+    return word;
+}
+
+/**
+ * Split 2-bit packed bases (4 per byte, first base in the lowest two bits, A = 0, C = 1,
+ * G = 2, T = 3) into the low and high bit of each base, i.e. the same bit arrays as
+ * sse3_convert2bit1() produces from characters. Bits after the last base are cleared.
+ * @param packed the packed bases, ceil(length / 4) bytes.
+ * @param length number of bases.
+ * @param bits0 low bits, ceil(length / 8) bytes rounded up to a multiple of 4.
+ * @param bits1 high bits, of the same size.
+ */
+inline void split_2bit_packed(const uint8_t* packed, int length, uint8_t* bits0, uint8_t* bits1) {
+    for (int base = 0; base < length; base += 32) {
+        // 32 bases per 64-bit word, without reading beyond the packed bytes
+        int bases = std::min(32, length - base);
+        uint64_t word = 0;
+        memcpy(&word, packed + base / 4, (bases + 3) / 4);
+        if (bases < 32) {
+            word &= (1ULL << (2 * bases)) - 1;
+        }
+        auto low = static_cast<uint32_t>(compact_even_bits(word));
+        auto high = static_cast<uint32_t>(compact_even_bits(word >> 1));
+        memcpy(bits0 + base / 8, &low, 4);
+        memcpy(bits1 + base / 8, &high, 4);
+    }
+}
+
+/**
+ * Run-length encode a list of alignment operations into a CIGAR string, e.g. "MMMID" -> "3M1I1D".
+ * @param operations one character (M, I or D) per operation.
+ * @param reversed true if the operations are listed from the end of the alignment, as
+ *                 produced by a traceback.
+ * @return the CIGAR string in forward order.
+ */
+inline std::string compress_CIGAR(const std::string& operations, bool reversed = false) {
+    std::string CIGAR;
+    int total = static_cast<int>(operations.size());
+    for (int done = 0; done < total;) {
+        char op = operations[reversed ? total - 1 - done : done];
+        int length = 1;
+        while (done + length < total && operations[reversed ? total - 1 - done - length : done + length] == op) {
+            length++;
+        }
+        CIGAR += std::to_string(length);
+        CIGAR += op;
+        done += length;
+    }
+    return CIGAR;
+}
+
+/**
+ * Expand a CIGAR string into one character per operation, e.g. "3M1I1D" -> "MMMID".
+ * @param CIGAR the CIGAR string.
+ * @return the list of operations.
+ */
+inline std::string expand_CIGAR(const std::string& CIGAR) {
+    std::string operations;
+    int length = 0;
+    for (char c : CIGAR) {
+        if (isdigit(c)) {
+            length = length * 10 + (c - '0');
+        } else {
+            operations.append(length, c);
+            length = 0;
+        }
+    }
+    return operations;
+}
 
 #endif //GASMA_UTILS_H
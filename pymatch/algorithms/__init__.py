@@ -3,4 +3,5 @@ from .LandauVishkin import LandauVishkin
 from .LEAP import LEAP
 from .NeedlemanWunsch import NeedlemanWunsch
 from .greedyShortsighted import GASMAShortsighted
-from .gasma import GASMAProjection
\ No newline at end of file
+from .gasma import GASMAProjection
+from .native import NativeAligner, NativeGASMA
\ No newline at end of file
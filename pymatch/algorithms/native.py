@@ -0,0 +1,216 @@
+"""
+Bindings to the C++ greedy aligner (hurdle_matrix) through the C interface of libgasma.so.
+
+The library is looked up in the GASMA_LIBRARY environment variable, then in the system library
+path, then in the usual build directories of GASMA/. Batches are passed as NumPy arrays without
+copying, and ctypes releases the GIL while the native workers run.
+"""
+import ctypes
+import ctypes.util
+import os
+
+import numpy as np
+
+MAX_LENGTH = 128
+MAX_CIGAR_OPS = 2 * MAX_LENGTH
+CIGAR_OPS = "MIDNSHP=X"
+
+ASCII = 0
+PACKED_2BIT = 1
+
+_ENCODER = np.zeros(256, dtype=np.uint8)
+for _code, _base in enumerate("ACGT"):
+    _ENCODER[ord(_base)] = _code
+    _ENCODER[ord(_base.lower())] = _code
+
+
+class _Options(ctypes.Structure):
+    _fields_ = [("band", ctypes.c_int32),
+                ("alignment_type", ctypes.c_int32),
+                ("mismatch", ctypes.c_int32),
+                ("gap_open", ctypes.c_int32),
+                ("gap_extend", ctypes.c_int32),
+                ("num_threads", ctypes.c_int32),
+                ("polish", ctypes.c_int32),
+                ("extended_cigar", ctypes.c_int32)]
+
+
+class _Result(ctypes.Structure):
+    _fields_ = [("status", ctypes.c_int32),
+                ("cost", ctypes.c_int32),
+                ("termination", ctypes.c_int32),
+                ("num_cigar_ops", ctypes.c_int32),
+                ("nm", ctypes.c_int32)]
+
+
+class _Sequences(ctypes.Structure):
+    _fields_ = [("data", ctypes.c_void_p),
+                ("stride", ctypes.c_int64),
+                ("lengths", ctypes.c_void_p),
+                ("encoding", ctypes.c_int32)]
+
+
+# gasma_result as a NumPy record, so that a whole batch of results is one array
+RESULT_DTYPE = np.dtype([("status", np.int32), ("cost", np.int32), ("termination", np.int32),
+                         ("num_cigar_ops", np.int32), ("nm", np.int32)])
+
+_library = None
+
+
+def loadLibrary(path=None):
+    """
+    Load libgasma.so once and declare the signatures of its functions.
+    """
+    global _library
+    if _library is not None and path is None:
+        return _library
+
+    candidates = [path, os.environ.get("GASMA_LIBRARY"), ctypes.util.find_library("gasma")]
+    root = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "GASMA")
+    for build in ["build", "cmake-build-release", "cmake-build-debug"]:
+        candidates.append(os.path.join(root, build, "libgasma.so"))
+    for candidate in candidates:
+        if candidate and (os.path.exists(candidate) or not os.path.dirname(candidate)):
+            try:
+                library = ctypes.CDLL(candidate)
+                break
+            except OSError:
+                continue
+    else:
+        raise OSError("libgasma.so not found, build the gasma-shared target or set GASMA_LIBRARY")
+
+    library.gasma_version.restype = ctypes.c_int32
+    library.gasma_default_options.argtypes = [ctypes.POINTER(_Options)]
+    library.gasma_create.argtypes = [ctypes.POINTER(_Options)]
+    library.gasma_create.restype = ctypes.c_void_p
+    library.gasma_destroy.argtypes = [ctypes.c_void_p]
+    library.gasma_align.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_int32, ctypes.c_char_p, ctypes.c_int32,
+                                    ctypes.c_void_p, ctypes.c_int32, ctypes.POINTER(_Result)]
+    library.gasma_align.restype = ctypes.c_int32
+    library.gasma_align_arrays.argtypes = [ctypes.c_void_p, ctypes.POINTER(_Sequences), ctypes.POINTER(_Sequences),
+                                           ctypes.c_int32, ctypes.c_void_p, ctypes.c_int32, ctypes.c_void_p]
+    library.gasma_align_arrays.restype = ctypes.c_int32
+    _library = library
+    return library
+
+
+def encodeSequences(strings, packed=False):
+    """
+    Store a list of strings as the rows of a 2-d uint8 array, either as characters or 2-bit
+    packed (4 bases per byte, first base in the lowest two bits, A = 0, C = 1, G = 2, T = 3).
+    Returns the array and the lengths of the strings.
+    """
+    lengths = np.array([len(s) for s in strings], dtype=np.int32)
+    width = int(lengths.max()) if len(strings) > 0 else 0
+    chars = np.zeros((len(strings), width), dtype=np.uint8)
+    for i, s in enumerate(strings):
+        chars[i, :len(s)] = np.frombuffer(s.encode(), dtype=np.uint8)
+    if not packed:
+        return chars, lengths
+    codes = _ENCODER[chars]
+    codes = np.pad(codes, ((0, 0), (0, (-width) % 4)))
+    codes = codes.reshape(len(strings), -1, 4)
+    return (codes[:, :, 0] | codes[:, :, 1] << 2 | codes[:, :, 2] << 4 | codes[:, :, 3] << 6).astype(np.uint8), lengths
+
+
+def cigarToString(cigar, numOps):
+    """
+    Convert binary CIGAR operations ((length << 4) | op) into a CIGAR string.
+    """
+    return "".join(str(op >> 4) + CIGAR_OPS[op & 15] for op in cigar[:numOps])
+
+
+class NativeAligner:
+    """
+    Greedy aligner running in C++. One aligner must not be used by two Python threads at the
+    same time; alignBatch() already uses `threads` native workers.
+    """
+    def __init__(self, k=3, semiGlobal=False, mismatchCost=1, gapOpenCost=1, gapExtendCost=1,
+                 threads=0, polish=False, extendedCigar=False, library=None):
+        self.library = loadLibrary(library)
+        options = _Options()
+        self.library.gasma_default_options(ctypes.byref(options))
+        options.band = k
+        options.alignment_type = 1 if semiGlobal else 0
+        options.mismatch = mismatchCost
+        options.gap_open = gapOpenCost
+        options.gap_extend = gapExtendCost
+        options.num_threads = threads
+        options.polish = int(polish)
+        options.extended_cigar = int(extendedCigar)
+        self.handle = self.library.gasma_create(ctypes.byref(options))
+        if not self.handle:
+            raise ValueError("invalid aligner options")
+        self.cigar = np.zeros(MAX_CIGAR_OPS, dtype=np.uint32)
+
+    def align(self, dna1, dna2):
+        """
+        Align one pair of strings and return the cost and the CIGAR string.
+        """
+        result = _Result()
+        read, ref = dna1.encode(), dna2.encode()
+        status = self.library.gasma_align(self.handle, read, len(read), ref, len(ref),
+                                          self.cigar.ctypes.data, MAX_CIGAR_OPS, ctypes.byref(result))
+        if status != 0:
+            raise ValueError("alignment failed with status %d" % status)
+        return result.cost, cigarToString(self.cigar, result.num_cigar_ops)
+
+    def alignBatch(self, reads, refs, readLengths, refLengths, packed=False, cigar=True):
+        """
+        Align reads[i] with refs[i] for every row, reading the arrays in place.
+        :param reads, refs: 2-d uint8 arrays with one sequence per row, as characters or 2-bit
+                            packed (see encodeSequences()). Rows must be contiguous.
+        :param readLengths, refLengths: number of bases of each sequence.
+        :param packed: whether the sequences are 2-bit packed.
+        :param cigar: whether to produce the CIGARs.
+        :return: the results (RESULT_DTYPE) and the binary CIGARs, one row per pair, or None.
+        """
+        reads, refs = np.asarray(reads), np.asarray(refs)
+        readLengths = np.ascontiguousarray(readLengths, dtype=np.int32)
+        refLengths = np.ascontiguousarray(refLengths, dtype=np.int32)
+        numPairs = len(readLengths)
+        if len(refLengths) != numPairs:
+            raise ValueError("readLengths and refLengths differ in size")
+        for array, lengths in ((reads, readLengths), (refs, refLengths)):
+            if array.dtype != np.uint8 or array.ndim != 2 or array.strides[1] != 1 or len(array) < numPairs:
+                raise ValueError("sequences must be a 2-d uint8 array with contiguous rows")
+            if array.strides[0] <= 0:
+                raise ValueError("sequences must have a positive row stride")
+            # the native code reads lengths[i] bases from row i, which must not run past the row
+            if numPairs > 0 and lengths.max() > array.shape[1] * (4 if packed else 1):
+                raise ValueError("a sequence is longer than the row holding it")
+
+        encoding = PACKED_2BIT if packed else ASCII
+        readSequences = _Sequences(reads.ctypes.data, reads.strides[0], readLengths.ctypes.data, encoding)
+        refSequences = _Sequences(refs.ctypes.data, refs.strides[0], refLengths.ctypes.data, encoding)
+        results = np.zeros(numPairs, dtype=RESULT_DTYPE)
+        cigars = np.zeros((numPairs, MAX_CIGAR_OPS), dtype=np.uint32) if cigar else None
+        status = self.library.gasma_align_arrays(self.handle, ctypes.byref(readSequences), ctypes.byref(refSequences),
+                                                 numPairs, cigars.ctypes.data if cigar else None, MAX_CIGAR_OPS,
+                                                 results.ctypes.data)
+        if status != 0:
+            raise ValueError("batch alignment failed with status %d" % status)
+        return results, cigars
+
+    def __del__(self):
+        if getattr(self, "handle", None):
+            self.library.gasma_destroy(self.handle)
+            self.handle = None
+
+
+class NativeGASMA:
+    """
+    Drop-in replacement of the pure Python algorithms for a single pair.
+    """
+    _aligners = {}
+
+    def __init__(self, dna1, dna2, k=3):
+        if k not in NativeGASMA._aligners:
+            NativeGASMA._aligners[k] = NativeAligner(k=k, threads=1)
+        self.cost, self.cigar = NativeGASMA._aligners[k].align(dna1, dna2)
+
+    def editDistance(self):
+        return self.cost
+
+    def CIGAR(self):
+        return self.cigar
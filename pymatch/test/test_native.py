@@ -0,0 +1,70 @@
+from pymatch.algorithms.native import NativeAligner, encodeSequences, cigarToString
+import random
+import time
+
+test_items = 1000
+random.seed(0)
+
+
+def editDistance(str1, str2):
+    previous = list(range(len(str2) + 1))
+    for i in range(1, len(str1) + 1):
+        current = [i] + [0] * len(str2)
+        for j in range(1, len(str2) + 1):
+            current[j] = min(previous[j] + 1, current[j - 1] + 1, previous[j - 1] + (str1[i - 1] != str2[j - 1]))
+        previous = current
+    return previous[-1]
+
+
+def mutate(string, errorRate=0.05, substitutionRate=0.8):
+    result = ""
+    for c in string:
+        r = random.random() / errorRate
+        if r < substitutionRate:
+            result += random.choice("ACGT")
+        elif r < (1 + substitutionRate) / 2:
+            result += c + random.choice("ACGT")
+        elif r >= 1:
+            result += c
+    return result
+
+
+reads = ["".join(random.choice("ACGT") for _ in range(100)) for _ in range(test_items)]
+refs = [mutate(read) for read in reads]
+
+aligner = NativeAligner(k=3)
+for packed in [False, True]:
+    readArray, readLengths = encodeSequences(reads, packed=packed)
+    refArray, refLengths = encodeSequences(refs, packed=packed)
+    currTime = time.time()
+    results, cigars = aligner.alignBatch(readArray, refArray, readLengths, refLengths, packed=packed)
+    print("Packed:" if packed else "ASCII:", time.time() - currTime, "s for", test_items, "pairs")
+
+    correct = 0
+    for i in range(test_items):
+        cost, cigar = aligner.align(reads[i], refs[i])
+        assert cost == results["cost"][i]
+        assert cigar == cigarToString(cigars[i], results["num_cigar_ops"][i])
+        distance = editDistance(reads[i], refs[i])
+        assert cost >= distance
+        correct += (cost == distance)
+    print("Correct rate:", correct / test_items)
+    # 0.79 with this seed, k = 3 and 5% errors
+    assert correct / test_items >= 0.75
+
+# rows that are shorter than the given lengths, or in reverse order, are rejected
+readArray, readLengths = encodeSequences(reads)
+refArray, refLengths = encodeSequences(refs)
+for args in [(readArray[:, :50], refArray, readLengths, refLengths),
+             (readArray[::-1], refArray, readLengths, refLengths)]:
+    try:
+        aligner.alignBatch(*args)
+        assert False, "invalid arrays were accepted"
+    except ValueError:
+        pass
+packedArray, packedLengths = encodeSequences(reads, packed=True)
+try:
+    aligner.alignBatch(packedArray, refArray, readLengths + 4, refLengths, packed=True)
+    assert False, "invalid arrays were accepted"
+except ValueError:
+    pass